@@ -13,37 +13,59 @@ function(compile_shaders)
         "${SHADER_SOURCE_DIR}/*.cs.slang"
     )
 
+    # Shaders using the FFT size get one variant per size ("name_<size>.cs.spv"),
+    # the FFT plans in the renderer pick them at runtime (must match FFT_SHADER_SIZES in renderer.hpp)
+    set(FFT_SHADER_SIZES 256 512 1024)
+
     foreach(SHADER ${SLANG_SOURCES})
         get_filename_component(BASE_NAME ${SHADER} NAME_WE)
         get_filename_component(EXT ${SHADER} EXT)  # e.g. .vx.slang -> .slang
         string(REPLACE ".slang" "" SHADER_STAGE ${EXT})  # produce .vx or .px
-        set(OUTPUT_SPV "${SHADER_OUTPUT_DIR}/${BASE_NAME}${SHADER_STAGE}.spv")
-        set(DEPFILE "${SHADER_OUTPUT_DIR}/${BASE_NAME}${SHADER_STAGE}.dep")
 
-        set(DEPFILE_OPT)
-        if (CMAKE_VERSION VERSION_GREATER_EQUAL "3.21.0")
-            list(APPEND DEPFILE_OPT DEPFILE "${DEPFILE}")
+        file(STRINGS ${SHADER} USES_FFT_SIZE REGEX "fft::(SIZE|HALF_SIZE|SPECTRUM_WIDTH)")
+        if (USES_FFT_SIZE)
+            set(VARIANTS ${FFT_SHADER_SIZES})
         else()
-            message(AUTHOR_WARNING
-                "CMake < 3.21 does not support depfiles. Shader dependencies won't be tracked."
-            )
+            set(VARIANTS "")
         endif()
 
-        add_custom_command(
-            OUTPUT ${OUTPUT_SPV}
-            COMMAND ${Python3_EXECUTABLE}
-                    ${SHADER_SCRIPT}
-                    --input ${SHADER}
-                    --output ${OUTPUT_SPV}
-                    --root ${SHADER_SOURCE_DIR}
-                    --depfile ${DEPFILE}
-            DEPENDS ${SHADER}
-            ${DEPFILE_OPT}
-            COMMENT "Compiling shader: ${BASE_NAME}${EXT}"
-            VERBATIM
-        )
-
-        list(APPEND SHADER_OUTPUTS ${OUTPUT_SPV})
+        foreach(VARIANT IN ITEMS "" ${VARIANTS})
+            if (VARIANT)
+                set(VARIANT_NAME "${BASE_NAME}_${VARIANT}")
+                set(DEFINE_OPT --define "FFT_SIZE=${VARIANT}")
+            else()
+                set(VARIANT_NAME "${BASE_NAME}")
+                set(DEFINE_OPT)
+            endif()
+            set(OUTPUT_SPV "${SHADER_OUTPUT_DIR}/${VARIANT_NAME}${SHADER_STAGE}.spv")
+            set(DEPFILE "${SHADER_OUTPUT_DIR}/${VARIANT_NAME}${SHADER_STAGE}.dep")
+
+            set(DEPFILE_OPT)
+            if (CMAKE_VERSION VERSION_GREATER_EQUAL "3.21.0")
+                list(APPEND DEPFILE_OPT DEPFILE "${DEPFILE}")
+            else()
+                message(AUTHOR_WARNING
+                    "CMake < 3.21 does not support depfiles. Shader dependencies won't be tracked."
+                )
+            endif()
+
+            add_custom_command(
+                OUTPUT ${OUTPUT_SPV}
+                COMMAND ${Python3_EXECUTABLE}
+                        ${SHADER_SCRIPT}
+                        --input ${SHADER}
+                        --output ${OUTPUT_SPV}
+                        --root ${SHADER_SOURCE_DIR}
+                        --depfile ${DEPFILE}
+                        ${DEFINE_OPT}
+                DEPENDS ${SHADER}
+                ${DEPFILE_OPT}
+                COMMENT "Compiling shader: ${VARIANT_NAME}${EXT}"
+                VERBATIM
+            )
+
+            list(APPEND SHADER_OUTPUTS ${OUTPUT_SPV})
+        endforeach()
     endforeach()
 
     # Group all shaders into a custom target
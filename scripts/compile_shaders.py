@@ -18,6 +18,7 @@ def parse_args():
     parser.add_argument("--output", required=True, help="Output SPIR-V file (.spv)")
     parser.add_argument("--root", required=True, help="Shader root directory")
     parser.add_argument("--depfile", required=False, help="Optional depfile for incremental build")
+    parser.add_argument("--define", action="append", default=[], help="Preprocessor define (NAME=VALUE)")
     return parser.parse_args()
 
 def detect_stage(shader_path: Path):
@@ -60,6 +61,9 @@ def main():
     if args.depfile:
         cmd += ["-depfile", str(args.depfile)]
 
+    for define in args.define:
+        cmd += ["-D", define]
+
     all_outputs = []
 
     print(f"[Slang] {stage.upper()} -> {output_file}")
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+/*
+ * Bounded Multi-Producer Multi-Consumer Queue (Lock-Free Ring of Sequenced Cells).
+ * Every cell carries a sequence number telling whether it is free for the producer of a position
+ * or holds the value for its consumer, so pushing & popping only take one compare-exchange.
+ * push() waits while the queue is full, which is what keeps the stages before it from running
+ * ahead (backpressure). The ring itself is a power of two (positions map to cells with a mask),
+ * but it is full at the requested capacity, so that is how many values can be in flight.
+ */
+template <typename T>
+class BoundedQueue
+{
+  public:
+    /* Holds at Most `capacity` Values (at Least 1) */
+    explicit BoundedQueue(size_t capacity) : capacity(std::max<size_t>(capacity, 1))
+    {
+        size_t size = 2;
+        while (size < this->capacity)
+            size *= 2;
+
+        cells = std::make_unique<Cell[]>(size);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /* Moves the Value in, Returns False (Leaving it Untouched) if the Queue is Full */
+    bool try_push(T& value)
+    {
+        size_t position = tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells[position & mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+            if (diff == 0)
+            {
+                /* A free cell past the capacity still counts as full, a stale head errs that way */
+                const size_t first = head.load(std::memory_order_acquire);
+                if ((intptr_t)(position - first) >= (intptr_t)capacity)
+                    return false;
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;
+            else
+                position = tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    /* Moves the Oldest Value Out, Returns False if the Queue is Empty */
+    bool try_pop(T& value)
+    {
+        size_t position = head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells[position & mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)sequence - (intptr_t)(position + 1);
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.value);
+                    cell.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;
+            else
+                position = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    /* Waits Until There is Room */
+    void push(T value)
+    {
+        for (uint32_t attempt = 0; !try_push(value); ++attempt)
+            backoff(attempt);
+    }
+
+    /* Waits for a Value, Returns False Once the Queue is Closed & Drained */
+    bool pop(T& value)
+    {
+        for (uint32_t attempt = 0;; ++attempt)
+        {
+            if (try_pop(value))
+                return true;
+            if (closed.load(std::memory_order_acquire))
+                return try_pop(value);
+            backoff(attempt);
+        }
+    }
+
+    /* Marks the End of the Input, Called Once All Producers are Done */
+    void close() { closed.store(true, std::memory_order_release); }
+
+  private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    /* Stages wait on disk & transforms, so after a short spin the waiting thread sleeps */
+    static void backoff(uint32_t attempt)
+    {
+        if (attempt < 64)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    std::unique_ptr<Cell[]> cells{};
+    size_t mask = 0;
+    size_t capacity = 0;
+
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    std::atomic<bool> closed{false};
+};
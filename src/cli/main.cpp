@@ -0,0 +1,559 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "fft/convolution.hpp"
+#include "fft/multires.hpp"
+#include "fft/thread_pool.hpp"
+#include "io/image_io.hpp"
+#include "io/image_writer.hpp"
+
+/*
+ * luceo-cli, Headless Batch Convolution on the CPU Engine.
+ * Every input is convolved with the aperture PSF and written to the output directory. Decoding,
+ * convolving & encoding are separate stages with their own threads, connected by bounded queues:
+ *   decode -> [decoded] -> transform (FFT -> multiply -> inverse FFT) -> [convolved] -> encode
+ * so disk & compute overlap, while a full queue stalls the stage feeding it. At most
+ * queue_depth * 2 + one per stage thread images are in memory, however many files are queued.
+ * The transforms themselves are spread over the FFT thread pool.
+ * With --tile-size images are convolved in overlap-save tiles sharing one kernel spectrum, and the
+ * transform stage streams the finished rows straight to the output file, so images far larger than
+ * a single padded transform only hold their (mapped) input, a band of rows & the tiles in flight.
+ * With --scale the convolution runs on a downsampled level & is upsampled afterwards, and
+ * --error-report also convolves at full resolution in one transform to print what scaling or
+ * tiling costs in quality (tiles should match it up to rounding, with any pool size).
+ */
+
+namespace fs = std::filesystem;
+
+/*
+ * Kernel Size Without --kernel-size, in Full Resolution Pixels. Bounded rather than the image size:
+ * that would pad a large image to twice its size per axis & defeat the tiling. Images smaller than
+ * it use their larger dimension, as a kernel past the image only adds padding.
+ */
+constexpr uint32_t DEFAULT_KERNEL_SIZE = 512;
+
+struct Options
+{
+    fft::ApertureParams aperture{};
+    fft::GlowParams glow{};
+    uint32_t kernel_size = 0; /* 0 = DEFAULT_KERNEL_SIZE (at most the larger image dimension) */
+    bool tiled = false;
+    uint32_t tile_size = 0;   /* 0 = picked by fft::tile_size */
+    uint32_t scale = 1;       /* Convolve at 1 / scale resolution */
+    bool error_report = false;
+    uint32_t threads = 0;     /* 0 = LUCEO_THREADS, or one per core */
+    uint32_t decode_threads = 2;
+    uint32_t transform_threads = 2; /* Images convolved at once (each using the pool) */
+    uint32_t encode_threads = 2;
+    uint32_t queue_depth = 4;       /* Of the decoded & convolved queues each */
+    std::string output_dir = ".";
+    std::string format{};     /* "hdr", "pfm" or "rgbaf", empty = same as the input */
+    std::string suffix = "_bloom";
+    std::vector<std::string> inputs{};
+};
+
+static void print_usage()
+{
+    printf("usage: luceo-cli [options] <image | glob | @list.txt>...\n"
+           "  -o, --output <dir>      output directory (default: .)\n"
+           "  -f, --format <fmt>      hdr, pfm or rgbaf (default: same as the input)\n"
+           "  --suffix <text>         appended to the output names (default: _bloom)\n"
+           "  --blades <n>            aperture blade count (default: 6)\n"
+           "  --radius <r>            aperture radius in uv space, 0-0.5 (default: 0.1)\n"
+           "  --rotation <degrees>    aperture rotation (default: 0)\n"
+           "  --glow <sigma>          gaussian glow standard deviation in pixels (default: 10)\n"
+           "  --glow-weight <w>       share of the glow in the kernel, 0-1, 1 = gaussian only\n"
+           "                          (default: 0)\n"
+           "  --kernel-size <n>       psf size in pixels (default: 512, or the larger image\n"
+           "                          dimension if smaller & not tiled)\n"
+           "  --tile-size <n|auto>    convolve in n x n overlap-save tiles, streaming the rows\n"
+           "                          to the output (default: one transform per image)\n"
+           "  --scale <n>             convolve at 1/n resolution & upsample, 2 or 4 (default: 1)\n"
+           "  --error-report          also convolve at full resolution in one transform &\n"
+           "                          print the error (of the scaled or tiled output)\n"
+           "  --threads <n>           fft worker threads (default: LUCEO_THREADS or one per core)\n"
+           "  --decode-threads <n>    threads loading images (default: 2)\n"
+           "  --transform-threads <n> images convolved at once (default: 2)\n"
+           "  --encode-threads <n>    threads writing images (default: 2)\n"
+           "  --queue-depth <n>       images buffered between the stages (default: 4)\n");
+}
+
+/* Returns True if the Name Matches the Pattern ('*' = Any Run, '?' = Any Character) */
+static bool match_wildcard(const char* pattern, const char* name)
+{
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (*name)
+    {
+        if (*pattern == '*')
+        {
+            star = pattern++;
+            resume = name;
+        }
+        else if (*pattern == '?' || *pattern == *name)
+            ++pattern, ++name;
+        else if (star)
+        {
+            pattern = star + 1;
+            name = ++resume;
+        }
+        else
+            return false;
+    }
+    while (*pattern == '*')
+        ++pattern;
+    return *pattern == '\0';
+}
+
+/* Expands an Argument Into Paths: a Plain Path, a Glob in its File Name, or an @list File */
+static void expand_input(const std::string& argument, std::vector<std::string>& paths)
+{
+    if (argument.size() > 1 && argument[0] == '@')
+    {
+        std::ifstream list(argument.substr(1));
+        if (!list)
+        {
+            printf("failed to open input list %s.\n", argument.c_str() + 1);
+            return;
+        }
+        for (std::string line{}; std::getline(list, line);)
+        {
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+                line.pop_back();
+            if (!line.empty())
+                expand_input(line, paths);
+        }
+        return;
+    }
+
+    /* Windows shells do not expand globs, so the file name part is matched here */
+    const fs::path path(argument);
+    const std::string pattern = path.filename().string();
+    if (pattern.find_first_of("*?") == std::string::npos)
+    {
+        paths.push_back(argument);
+        return;
+    }
+
+    const fs::path directory = path.has_parent_path() ? path.parent_path() : fs::path(".");
+    std::error_code error{};
+    std::vector<std::string> matches{};
+    for (const fs::directory_entry& entry : fs::directory_iterator(directory, error))
+    {
+        const std::string name = entry.path().filename().string();
+        if (entry.is_regular_file(error) && match_wildcard(pattern.c_str(), name.c_str()))
+            matches.push_back(entry.path().string());
+    }
+    if (matches.empty())
+        printf("no files match %s.\n", argument.c_str());
+
+    std::sort(matches.begin(), matches.end());
+    paths.insert(paths.end(), matches.begin(), matches.end());
+}
+
+static bool parse_options(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        auto value = [&]() { return argv[++i]; };
+
+        if (arg == "-h" || arg == "--help")
+            return false;
+        else if ((arg == "-o" || arg == "--output") && has_value)
+            options.output_dir = value();
+        else if ((arg == "-f" || arg == "--format") && has_value)
+            options.format = value();
+        else if (arg == "--suffix" && has_value)
+            options.suffix = value();
+        else if (arg == "--blades" && has_value)
+            options.aperture.num_blades = (uint32_t)std::strtoul(value(), nullptr, 10);
+        else if (arg == "--radius" && has_value)
+            options.aperture.radius = std::strtof(value(), nullptr);
+        else if (arg == "--rotation" && has_value)
+            options.aperture.rotation = std::strtof(value(), nullptr) * 3.14159265f / 180.0f;
+        else if (arg == "--glow" && has_value)
+            options.glow.sigma = std::strtof(value(), nullptr);
+        else if (arg == "--glow-weight" && has_value)
+            options.glow.weight = std::strtof(value(), nullptr);
+        else if (arg == "--kernel-size" && has_value)
+            options.kernel_size = (uint32_t)std::strtoul(value(), nullptr, 10);
+        else if (arg == "--tile-size" && has_value)
+        {
+            const std::string tile = value();
+            options.tile_size = (uint32_t)std::strtoul(tile.c_str(), nullptr, 10);
+            options.tiled = tile == "auto" || options.tile_size != 0;
+        }
+        else if (arg == "--scale" && has_value)
+            options.scale = (uint32_t)std::strtoul(value(), nullptr, 10);
+        else if (arg == "--error-report")
+            options.error_report = true;
+        else if (arg == "--threads" && has_value)
+            options.threads = (uint32_t)std::strtoul(value(), nullptr, 10);
+        else if (arg == "--decode-threads" && has_value)
+            options.decode_threads = (uint32_t)std::strtoul(value(), nullptr, 10);
+        else if (arg == "--transform-threads" && has_value)
+            options.transform_threads = (uint32_t)std::strtoul(value(), nullptr, 10);
+        else if (arg == "--encode-threads" && has_value)
+            options.encode_threads = (uint32_t)std::strtoul(value(), nullptr, 10);
+        else if (arg == "--queue-depth" && has_value)
+            options.queue_depth = (uint32_t)std::strtoul(value(), nullptr, 10);
+        else if (arg[0] == '-' && arg.size() > 1)
+        {
+            printf("unknown or incomplete option %s.\n", arg.c_str());
+            return false;
+        }
+        else
+            expand_input(arg, options.inputs);
+    }
+
+    if (options.aperture.num_blades < 3 || options.aperture.radius <= 0.0f)
+    {
+        printf("the aperture needs at least 3 blades and a positive radius.\n");
+        return false;
+    }
+    if (options.glow.sigma <= 0.0f || options.glow.weight < 0.0f || options.glow.weight > 1.0f)
+    {
+        printf("the glow needs a positive sigma and a weight of 0-1.\n");
+        return false;
+    }
+    if (!options.decode_threads || !options.transform_threads || !options.encode_threads ||
+        !options.queue_depth)
+    {
+        printf("every stage needs at least one thread and the queues at least one slot.\n");
+        return false;
+    }
+    if (!options.format.empty() && options.format != "hdr" && options.format != "pfm" &&
+        options.format != "rgbaf")
+    {
+        printf("unknown output format %s.\n", options.format.c_str());
+        return false;
+    }
+    if (options.scale != 1 && options.scale != 2 && options.scale != 4)
+    {
+        printf("the scale has to be 1, 2 or 4.\n");
+        return false;
+    }
+    if (options.scale > 1 && options.tiled)
+    {
+        printf("--scale cannot be combined with --tile-size.\n");
+        return false;
+    }
+    const uint32_t tiled_kernel_size = options.kernel_size
+                                           ? options.kernel_size + (options.kernel_size & 1u)
+                                           : DEFAULT_KERNEL_SIZE;
+    if (options.tiled && options.tile_size &&
+        (options.tile_size & 1u || options.tile_size <= tiled_kernel_size))
+    {
+        printf("the tile size has to be even & larger than the kernel size.\n");
+        return false;
+    }
+    return !options.inputs.empty();
+}
+
+/* Builds the Kernel Spectrum of a size x size PSF in a padded_width x padded_height Transform */
+static void build_kernel_spectrum(const Options& options, uint32_t size, uint32_t padded_width,
+                                  uint32_t padded_height, uint32_t scale,
+                                  fft::KernelSpectrum& kernel)
+{
+    /* A Gaussian alone is written straight into the spectrum, no aperture is built */
+    const fft::GlowParams glow = fft::scale_glow(options.glow, scale);
+    if (glow.weight >= 1.0f)
+    {
+        fft::gaussian_kernel(glow.sigma, padded_width, padded_height, kernel);
+        return;
+    }
+
+    const fft::ApertureParams aperture = fft::scale_aperture(options.aperture, scale);
+    fft::build_kernel(aperture, size, padded_width, padded_height, kernel);
+    fft::add_glow(glow, kernel);
+}
+
+/*
+ * Kernel Spectra per (Image Width, Height, Scale), Built Once by the First Image of That Size.
+ * The sizes are the ones transformed, i.e. of the downsampled level for a scale above 1.
+ * Tiled runs with a fixed --tile-size share a single kernel, whatever the image sizes; the
+ * automatic tile size depends on the image size (small images fit in one tile).
+ */
+class KernelCache
+{
+  public:
+    struct Entry
+    {
+        std::once_flag built{};
+        uint32_t size = 0; /* Of the PSF, in pixels */
+        fft::KernelSpectrum kernel{};
+    };
+
+    explicit KernelCache(const Options& options) : options(options) {}
+
+    const Entry& get(uint32_t width, uint32_t height, uint32_t scale = 1)
+    {
+        if (options.tiled && options.tile_size)
+            width = height = 0;
+
+        Entry* entry = nullptr;
+        {
+            std::lock_guard lock(mutex);
+            std::unique_ptr<Entry>& slot = entries[{width, height, scale}];
+            if (!slot)
+                slot = std::make_unique<Entry>();
+            entry = slot.get();
+        }
+
+        /* Images of other sizes are not held up while this one is built */
+        std::call_once(entry->built, [&]() {
+            /* --kernel-size is in full resolution pixels */
+            const uint32_t kernel_size =
+                options.kernel_size ? options.kernel_size : DEFAULT_KERNEL_SIZE;
+            uint32_t size = kernel_size / scale;
+            if (!options.kernel_size && !options.tiled)
+                size = std::min(size, std::max(width, height));
+            size = std::max(size + (size & 1u), 2u);
+            entry->size = size;
+
+            uint32_t padded_width = 0, padded_height = 0;
+            if (options.tiled)
+                padded_width = padded_height = options.tile_size
+                                                   ? options.tile_size
+                                                   : fft::tile_size(size, width, height);
+            else
+                fft::convolution_size(width, height, size, padded_width, padded_height);
+
+            build_kernel_spectrum(options, size, padded_width, padded_height, scale,
+                                  entry->kernel);
+        });
+        return *entry;
+    }
+
+  private:
+
+    const Options& options;
+    std::mutex mutex{};
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, std::unique_ptr<Entry>> entries{};
+};
+
+/* One Image Moving Through the Pipeline */
+struct Job
+{
+    size_t index = 0;      /* Into Options::inputs */
+    io::ImageFile input{}; /* Raw inputs stay mapped, nothing is decoded */
+    fft::ImageRGBA output{};
+};
+
+static std::vector<std::thread> start_stage(uint32_t thread_count, const std::function<void()>& fn)
+{
+    std::vector<std::thread> threads{};
+    for (uint32_t i = 0; i < thread_count; ++i)
+        threads.emplace_back(fn);
+    return threads;
+}
+
+static void join_stage(std::vector<std::thread>& threads)
+{
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+/*
+ * Convolves the Input in One Full Resolution Transform & Prints the Error of the Output (Scaled
+ * or Tiled, Described by `mode`) Against it
+ */
+static void report_error(const std::string& name, const char* mode, const fft::ImageView& input,
+                         const fft::ImageView& output, double milliseconds,
+                         const fft::KernelSpectrum& reference_kernel)
+{
+    const auto start = std::chrono::steady_clock::now();
+    fft::ImageRGBA reference{};
+    fft::convolve(input, reference_kernel, reference);
+    const double reference_milliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const fft::ImageError error = fft::compare_images(reference, output);
+    printf("%s: %s %.1fms, full %.1fms, max error %g, rmse %g (%.3f%%), psnr %.2fdB\n",
+           name.c_str(), mode, milliseconds, reference_milliseconds, error.max_abs, error.rmse,
+           error.relative_rmse * 100.0, error.psnr);
+}
+
+static std::string output_path(const Options& options, const std::string& input)
+{
+    /* Without a format the output keeps the input's, unless it cannot be written (LDR) */
+    std::string format = options.format;
+    if (format.empty())
+    {
+        const io::ImageFormat input_format = io::get_image_format(input);
+        format = input_format == io::ImageFormat::PFM   ? "pfm"
+                 : input_format == io::ImageFormat::RAW ? "rgbaf"
+                                                        : "hdr";
+    }
+
+    const std::string name = fs::path(input).stem().string() + options.suffix + "." + format;
+    return (fs::path(options.output_dir) / name).string();
+}
+
+int main(int argc, char** argv)
+{
+    Options options{};
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage();
+        return 1;
+    }
+
+    std::error_code error{};
+    fs::create_directories(options.output_dir, error);
+    if (options.threads)
+        fft::set_thread_count(options.threads);
+
+    KernelCache kernels(options);
+    std::atomic<uint32_t> failures{0};
+    const auto start = std::chrono::steady_clock::now();
+
+    BoundedQueue<Job> decoded(options.queue_depth);
+    BoundedQueue<Job> convolved(options.queue_depth);
+    std::atomic<size_t> next_input{0};
+
+    /* Decode: claims the next input file, waits for room in the decoded queue */
+    std::vector<std::thread> decoders = start_stage(options.decode_threads, [&]() {
+        for (size_t i = next_input.fetch_add(1); i < options.inputs.size();
+             i = next_input.fetch_add(1))
+        {
+            Job job{};
+            job.index = i;
+            if (!job.input.open(options.inputs[i]))
+            {
+                printf("failed to load %s.\n", options.inputs[i].c_str());
+                failures.fetch_add(1);
+                continue;
+            }
+            decoded.push(std::move(job));
+        }
+    });
+
+    /* Transform: FFT -> multiply -> inverse FFT, the input is released once it is convolved */
+    std::vector<std::thread> transformers = start_stage(options.transform_threads, [&]() {
+        Job job{};
+        while (decoded.pop(job))
+        {
+            const fft::ImageView& input = job.input.view();
+            if (options.tiled)
+            {
+                const KernelCache::Entry& kernel = kernels.get(input.width, input.height);
+                /* The bands are written as they finish, nothing goes to the encoders */
+                const std::string destination = output_path(options, options.inputs[job.index]);
+                io::ImageWriter writer{};
+                /* The error report needs the whole output, the rows are kept for it */
+                if (options.error_report)
+                    job.output.resize(input.width, input.height);
+                const auto start_time = std::chrono::steady_clock::now();
+                bool ok = writer.open(destination, input.width, input.height) &&
+                          fft::convolve_tiled(
+                              input, kernel.kernel, kernel.size,
+                              [&](const float* rows, size_t row_stride, uint32_t y,
+                                  uint32_t count) {
+                                  writer.write_rows(rows, row_stride, count);
+                                  for (uint32_t i = 0; i < count && options.error_report; ++i)
+                                      std::copy_n(rows + i * row_stride, (size_t)input.width * 4,
+                                                  &job.output.pixels[(size_t)(y + i) *
+                                                                     input.width * 4]);
+                              });
+                const double milliseconds = std::chrono::duration<double, std::milli>(
+                                                std::chrono::steady_clock::now() - start_time)
+                                                .count();
+                ok = writer.close() && ok;
+
+                /* Against one untiled transform with the same PSF, on the same thread pool */
+                if (ok && options.error_report)
+                {
+                    uint32_t padded_width = 0, padded_height = 0;
+                    fft::convolution_size(input.width, input.height, kernel.size, padded_width,
+                                          padded_height);
+                    fft::KernelSpectrum reference_kernel{};
+                    build_kernel_spectrum(options, kernel.size, padded_width, padded_height, 1,
+                                          reference_kernel);
+                    report_error(options.inputs[job.index], "tiled", input, job.output,
+                                 milliseconds, reference_kernel);
+                }
+                job.input.close();
+                if (!ok)
+                {
+                    printf("failed to convolve %s into %s.\n", options.inputs[job.index].c_str(),
+                           destination.c_str());
+                    failures.fetch_add(1);
+                }
+                continue;
+            }
+
+            /* Scaled runs transform the downsampled level with a kernel of its own size */
+            const uint32_t scale = options.scale;
+            const KernelCache::Entry& kernel = kernels.get(
+                (input.width + scale - 1) / scale, (input.height + scale - 1) / scale, scale);
+
+            const auto start_time = std::chrono::steady_clock::now();
+            const bool ok = fft::convolve_downsampled(input, scale, kernel.kernel, job.output);
+            const double milliseconds = std::chrono::duration<double, std::milli>(
+                                            std::chrono::steady_clock::now() - start_time)
+                                            .count();
+            if (ok && options.error_report)
+            {
+                const std::string mode = "1/" + std::to_string(scale) + " resolution";
+                report_error(options.inputs[job.index], mode.c_str(), input, job.output,
+                             milliseconds, kernels.get(input.width, input.height).kernel);
+            }
+            job.input.close();
+            if (!ok)
+            {
+                printf("failed to convolve %s.\n", options.inputs[job.index].c_str());
+                failures.fetch_add(1);
+                continue;
+            }
+            convolved.push(std::move(job));
+        }
+    });
+
+    /* Encode */
+    std::vector<std::thread> encoders = start_stage(options.encode_threads, [&]() {
+        Job job{};
+        while (convolved.pop(job))
+        {
+            const std::string destination = output_path(options, options.inputs[job.index]);
+            if (!io::save_image(destination, job.output))
+            {
+                printf("failed to write %s.\n", destination.c_str());
+                failures.fetch_add(1);
+            }
+        }
+    });
+
+    /* Every stage ends once the one before it has finished & its queue is drained */
+    join_stage(decoders);
+    decoded.close();
+    join_stage(transformers);
+    convolved.close();
+    join_stage(encoders);
+
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t done = options.inputs.size() - failures.load();
+    printf("convolved %zu of %zu images in %.2fs (%.2f images/s).\n", done, options.inputs.size(),
+           seconds, (double)done / seconds);
+
+    return failures.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace fft
+{
+
+/* Allocator Returning Cache Line Aligned Memory, so SIMD Kernels Never Split a Line */
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&)
+    {
+    }
+
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{Alignment}));
+    }
+
+    void deallocate(T* ptr, size_t)
+    {
+        ::operator delete(ptr, std::align_val_t{Alignment});
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const
+    {
+        return true;
+    }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+} // namespace fft
@@ -0,0 +1,69 @@
+#pragma once
+
+/*
+ * Cache-Blocked Transpose, Templated on a SIMD Type (Only Included by the kernels_*.cpp Files).
+ * The matrix is walked in tiles that fit in L1 for both the source and the destination, and
+ * inside a tile 8x8 blocks are transposed in registers when the vector type supports it.
+ */
+
+#include "kernels.hpp"
+#include "simd.hpp"
+
+namespace fft
+{
+namespace
+{
+
+constexpr uint32_t TRANSPOSE_TILE = 32;
+
+/* dst[x][y] = src[y][x] for a single block, one element at a time */
+inline void transpose_scalar(const float* src, size_t src_stride, float* dst, size_t dst_stride,
+                             uint32_t width, uint32_t height)
+{
+    for (uint32_t y = 0; y < height; ++y)
+        for (uint32_t x = 0; x < width; ++x)
+            dst[x * dst_stride + y] = src[y * src_stride + x];
+}
+
+template <typename V>
+void blocked_transpose(const float* src, size_t src_stride, float* dst, size_t dst_stride,
+                       uint32_t width, uint32_t height)
+{
+    for (uint32_t ty = 0; ty < height; ty += TRANSPOSE_TILE)
+    {
+        const uint32_t tile_h = height - ty < TRANSPOSE_TILE ? height - ty : TRANSPOSE_TILE;
+        for (uint32_t tx = 0; tx < width; tx += TRANSPOSE_TILE)
+        {
+            const uint32_t tile_w = width - tx < TRANSPOSE_TILE ? width - tx : TRANSPOSE_TILE;
+            const float* tile_src = src + ty * src_stride + tx;
+            float* tile_dst = dst + tx * dst_stride + ty;
+
+            if constexpr (V::WIDTH == 8)
+            {
+                if (tile_w % 8 == 0 && tile_h % 8 == 0)
+                {
+                    for (uint32_t y = 0; y < tile_h; y += 8)
+                    {
+                        for (uint32_t x = 0; x < tile_w; x += 8)
+                        {
+                            typename V::T rows[8];
+                            for (uint32_t i = 0; i < 8; ++i)
+                                rows[i] = V::load(tile_src + (y + i) * src_stride + x);
+
+                            V::transpose8(rows);
+
+                            for (uint32_t i = 0; i < 8; ++i)
+                                V::store(tile_dst + (x + i) * dst_stride + y, rows[i]);
+                        }
+                    }
+                    continue;
+                }
+            }
+
+            transpose_scalar(tile_src, src_stride, tile_dst, dst_stride, tile_w, tile_h);
+        }
+    }
+}
+
+} // namespace
+} // namespace fft
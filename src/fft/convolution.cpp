@@ -0,0 +1,547 @@
+#include "convolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include "thread_pool.hpp"
+
+namespace fft
+{
+
+static const float PI = 3.14159265f;
+
+static Packing packing_mode = Packing::REAL;
+
+/* SDF for a regular polygon centered at origin (same as aperture_mask.cs) */
+static float sdf_polygon(float px, float py, float r, uint32_t n)
+{
+    /* Angle per segment */
+    const float seg_angle = 2.0f * PI / (float)n;
+
+    /* Snap to nearest segment center */
+    const float angle = std::atan2(py, px);
+    const float a = std::floor((angle + seg_angle * 0.5f) / seg_angle) * seg_angle;
+
+    /* Rotate point into segment-local space */
+    const float local_x = px * std::cos(a) + py * std::sin(a);
+    const float edge_dist = r * std::cos(PI / (float)n);
+
+    return local_x - edge_dist;
+}
+
+ImageRGBA::ImageRGBA(uint32_t width, uint32_t height)
+{
+    resize(width, height);
+}
+
+void ImageRGBA::resize(uint32_t new_width, uint32_t new_height)
+{
+    width = new_width;
+    height = new_height;
+    pixels.assign((size_t)width * height * 4, 0.0f);
+}
+
+void ComplexRGB::resize(uint32_t width, uint32_t height)
+{
+    r.resize(width, height);
+    g.resize(width, height);
+    b.resize(width, height);
+}
+
+void KernelSpectrum::resize(uint32_t new_width, uint32_t new_height)
+{
+    width = new_width;
+    height = new_height;
+    values.assign((size_t)width * height, 0.0f);
+}
+
+void aperture_mask(const ApertureParams& params, uint32_t size, ImageRGBA& output)
+{
+    output.resize(size, size);
+
+    const float cs = std::cos(params.rotation);
+    const float sn = std::sin(params.rotation);
+
+    for (uint32_t y = 0; y < size; ++y)
+    {
+        for (uint32_t x = 0; x < size; ++x)
+        {
+            /* Center UV coordinates: (0,0) is center of image */
+            const float u = ((float)x + 0.5f) / (float)size - 0.5f;
+            const float v = ((float)y + 0.5f) / (float)size - 0.5f;
+
+            /* Apply rotation */
+            const float rx = u * cs - v * sn;
+            const float ry = u * sn + v * cs;
+
+            /* Hard edge: 1 inside, 0 outside */
+            const float d = sdf_polygon(rx, ry, params.radius, params.num_blades);
+            const float mask = d < 0.0f ? 1.0f : 0.0f;
+
+            float* pixel = &output.pixels[((size_t)y * size + x) * 4];
+            pixel[0] = mask;
+            pixel[1] = mask;
+            pixel[2] = mask;
+            pixel[3] = 1.0f;
+        }
+    }
+}
+
+void set_packing(Packing packing)
+{
+    packing_mode = packing;
+}
+
+Packing get_packing()
+{
+    return packing_mode;
+}
+
+void fft_2d_real(const ImageView& input, ComplexRGB& output)
+{
+    /* Every channel is read straight from the interleaved RGBA pixels */
+    const float* pixels = input.pixels;
+    const size_t row_stride = (size_t)input.width * 4;
+    if (packing_mode == Packing::PAIRED)
+        fft_2d_real_pair(pixels + 0, pixels + 1, input.width, input.height, 4, row_stride,
+                         output.r, output.g);
+    else
+    {
+        fft_2d_real(pixels + 0, input.width, input.height, 4, row_stride, output.r);
+        fft_2d_real(pixels + 1, input.width, input.height, 4, row_stride, output.g);
+    }
+    fft_2d_real(pixels + 2, input.width, input.height, 4, row_stride, output.b);
+}
+
+void ifft_2d_real(ComplexRGB& image, ImageRGBA& output)
+{
+    output.resize((image.r.width - 1) * 2, image.r.height);
+
+    float* pixels = output.pixels.data();
+    const size_t row_stride = (size_t)output.width * 4;
+    if (packing_mode == Packing::PAIRED)
+        ifft_2d_real_pair(image.r, image.g, pixels + 0, pixels + 1, 4, row_stride);
+    else
+    {
+        ifft_2d_real(image.r, pixels + 0, 4, row_stride);
+        ifft_2d_real(image.g, pixels + 1, 4, row_stride);
+    }
+    ifft_2d_real(image.b, pixels + 2, 4, row_stride);
+
+    const size_t count = (size_t)output.width * output.height;
+    for (size_t i = 0; i < count; ++i)
+        output.pixels[i * 4 + 3] = 1.0f;
+}
+
+void compute_psf(const ComplexRGB& aperture, const ApertureParams& params, ImageRGBA& psf)
+{
+    const uint32_t half = aperture.r.width - 1;
+    const uint32_t width = half * 2;
+    const uint32_t height = aperture.r.height;
+    psf.resize(width, height);
+
+    /* Area of regular polygon in pixels: A = (n/2) * R² * sin(2π/n), where R = RADIUS * N */
+    const float radius = params.radius * (float)width;
+    const float blades = (float)params.num_blades;
+    const float area = 0.5f * blades * radius * radius * std::sin(2.0f * PI / blades);
+
+    /* Normalize: 1/N² for FFT scaling, 1/area for energy preservation */
+    const float norm = 1.0f / ((float)width * (float)height * area);
+
+    const ComplexPlane* src[3] = {&aperture.r, &aperture.g, &aperture.b};
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            /* The missing half of the spectrum mirrors the stored one: |A(-k)|² = |A(k)|² */
+            const bool mirrored = x > half;
+            const uint32_t kx = mirrored ? width - x : x;
+            const uint32_t ky = mirrored ? (height - y) % height : y;
+            const size_t i = (size_t)ky * (half + 1) + kx;
+
+            float* pixel = &psf.pixels[((size_t)y * width + x) * 4];
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                /* |complex|² = real² + imag² */
+                const float re = src[c]->re[i];
+                const float im = src[c]->im[i];
+                pixel[c] = (re * re + im * im) * norm;
+            }
+            pixel[3] = 1.0f;
+        }
+    }
+}
+
+void freq_multiply(ComplexRGB& image, const KernelSpectrum& kernel)
+{
+    /* A real kernel only scales each frequency, the one spectrum serves every channel */
+    ComplexPlane* dst[3] = {&image.r, &image.g, &image.b};
+    const float* ker = kernel.values.data();
+    const size_t count = (size_t)image.r.width * image.r.height;
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        float* img_re = dst[c]->re.data();
+        float* img_im = dst[c]->im.data();
+        for (size_t i = 0; i < count; ++i)
+        {
+            img_re[i] *= ker[i];
+            img_im[i] *= ker[i];
+        }
+    }
+}
+
+/*
+ * Spectrum of a Normalised Gaussian Along One Axis of a size Point Transform. Sampling the
+ * continuous transform at k / size periodizes the PSF like the circular convolution does, the
+ * neighbouring spectral copies account for the PSF being sampled (they matter for sigma < 1).
+ */
+static std::vector<float> gaussian_spectrum_1d(float sigma, uint32_t size, uint32_t count)
+{
+    const double pi = 3.141592653589793;
+    const double factor = -2.0 * pi * pi * (double)sigma * (double)sigma;
+    std::vector<float> table(count);
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        const int64_t wrapped = k <= size / 2 ? (int64_t)k : (int64_t)k - (int64_t)size;
+        const double f = (double)wrapped / (double)size;
+        double value = 0.0;
+        for (int32_t m = -1; m <= 1; ++m)
+            value += std::exp(factor * (f + m) * (f + m));
+        table[k] = (float)value;
+    }
+    return table;
+}
+
+/* Writes (weight = 1) or Blends in the Gaussian Spectrum, Which is Real Like the Kernel */
+static void blend_gaussian(float sigma, float weight, KernelSpectrum& kernel)
+{
+    const uint32_t spectrum_width = kernel.width;
+    const uint32_t height = kernel.height;
+    const std::vector<float> gx =
+        gaussian_spectrum_1d(sigma, (spectrum_width - 1) * 2, spectrum_width);
+    const std::vector<float> gy = gaussian_spectrum_1d(sigma, height, height);
+
+    const float keep = 1.0f - weight;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        float* row = kernel.row(y);
+        for (uint32_t x = 0; x < spectrum_width; ++x)
+            row[x] = keep * row[x] + weight * gy[y] * gx[x];
+    }
+}
+
+void gaussian_kernel(float sigma, uint32_t width, uint32_t height, KernelSpectrum& kernel)
+{
+    kernel.resize(width / 2 + 1, height);
+    blend_gaussian(sigma, 1.0f, kernel);
+}
+
+void add_glow(const GlowParams& glow, KernelSpectrum& kernel)
+{
+    if (glow.weight > 0.0f)
+        blend_gaussian(glow.sigma, std::min(glow.weight, 1.0f), kernel);
+}
+
+/* Source index for a padded index: the image itself, or the nearest edge (which may be across) */
+static uint32_t clamp_index(uint32_t i, uint32_t size, uint32_t padded)
+{
+    if (i < size)
+        return i;
+    return i - (size - 1) <= padded - i ? size - 1 : 0;
+}
+
+/* Area of the Regular Polygon in Pixels: A = (n/2) * R² * sin(2π/n), Where R = radius * size */
+static float aperture_area(const ApertureParams& params, uint32_t size)
+{
+    const float radius = params.radius * (float)size;
+    const float blades = (float)params.num_blades;
+    return 0.5f * blades * radius * radius * std::sin(2.0f * PI / blades);
+}
+
+/*
+ * Power Spectrum |FFT(aperture)|² of a Single Channel of the Aperture: the Spectrum of its
+ * Autocorrelation (Wiener-Khinchin), & Also the Unnormalised PSF Image (Half of it, Real)
+ */
+static void aperture_power(const ApertureParams& params, uint32_t size, ComplexPlane& spectrum)
+{
+    ImageRGBA aperture_img{};
+    aperture_mask(params, size, aperture_img);
+
+    fft_2d_real(aperture_img.pixels.data(), size, size, 4, (size_t)size * 4, spectrum);
+    for (size_t i = 0; i < spectrum.re.size(); ++i)
+    {
+        spectrum.re[i] = spectrum.re[i] * spectrum.re[i] + spectrum.im[i] * spectrum.im[i];
+        spectrum.im[i] = 0.0f;
+    }
+}
+
+void build_kernel(const ApertureParams& params, uint32_t size, KernelSpectrum& kernel)
+{
+    /*
+     * The kernel is the transform of PSF = |FFT(aperture)|² / (N² area), which by Wiener-Khinchin
+     * is the (circular) autocorrelation of the aperture / area: real, symmetric & the same in every
+     * channel. So one real FFT pair of a single channel replaces the 2 RGB transforms of the chain
+     */
+    ComplexPlane spectrum{};
+    aperture_power(params, size, spectrum);
+
+    std::vector<float> autocorrelation((size_t)size * size);
+    ifft_2d_real(spectrum, autocorrelation.data(), 1, size);
+
+    /* The autocorrelation at pixel offset k is the kernel spectrum at frequency k */
+    const uint32_t half = size / 2 + 1;
+    const float norm = 1.0f / aperture_area(params, size);
+    kernel.resize(half, size);
+    for (uint32_t y = 0; y < size; ++y)
+    {
+        float* row = kernel.row(y);
+        for (uint32_t x = 0; x < half; ++x)
+            row[x] = autocorrelation[(size_t)y * size + x] * norm;
+    }
+}
+
+void convolution_size(uint32_t width, uint32_t height, uint32_t kernel_size, uint32_t& padded_width,
+                      uint32_t& padded_height)
+{
+    /* The padding has to hold the kernel reaching past both edges (clamped to different pixels) */
+    padded_width = good_size(std::max(width + kernel_size - 1, kernel_size), true);
+    padded_height = good_size(std::max(height + kernel_size - 1, kernel_size));
+}
+
+void build_kernel(const ApertureParams& params, uint32_t size, uint32_t padded_width,
+                  uint32_t padded_height, KernelSpectrum& kernel)
+{
+    /*
+     * The PSF is the power spectrum of the aperture at size, so it is embedded into the padded
+     * transform straight from there. Like build_kernel, a single channel is transformed instead
+     * of the RGB aperture & PSF images, the kernel is the same in every channel.
+     */
+    ComplexPlane spectrum{};
+    aperture_power(params, size, spectrum);
+    const uint32_t half = size / 2;
+    const float norm = 1.0f / ((float)size * (float)size * aperture_area(params, size));
+
+    /* The PSF is centered on pixel (0, 0) with wrap-around, so every quadrant keeps its corner */
+    std::vector<float> padded((size_t)padded_width * padded_height, 0.0f);
+    for (uint32_t y = 0; y < size; ++y)
+    {
+        const int32_t dy = y < size / 2 ? (int32_t)y : (int32_t)y - (int32_t)size;
+        const uint32_t py = (uint32_t)((dy + (int32_t)padded_height) % (int32_t)padded_height);
+        for (uint32_t x = 0; x < size; ++x)
+        {
+            const int32_t dx = x < size / 2 ? (int32_t)x : (int32_t)x - (int32_t)size;
+            const uint32_t px = (uint32_t)((dx + (int32_t)padded_width) % (int32_t)padded_width);
+
+            /* The missing half of the power spectrum mirrors the stored one (compute_psf) */
+            const bool mirrored = x > half;
+            const uint32_t kx = mirrored ? size - x : x;
+            const uint32_t ky = mirrored ? (size - y) % size : y;
+            const float power = spectrum.re[(size_t)ky * (half + 1) + kx];
+            padded[(size_t)py * padded_width + px] = power * norm;
+        }
+    }
+
+    /*
+     * Bring PSF Image to Freq Domain. Only the Nyquist row & column of the PSF (dx or dy =
+     * -size / 2) lack their mirror image here, keeping the real part is the same as splitting
+     * them evenly between both sides: the PSF becomes centrosymmetric & its spectrum real.
+     */
+    ComplexPlane spectrum_padded{};
+    fft_2d_real(padded.data(), padded_width, padded_height, 1, padded_width, spectrum_padded);
+    kernel.width = spectrum_padded.width;
+    kernel.height = spectrum_padded.height;
+    kernel.values = std::move(spectrum_padded.re);
+}
+
+bool convolve(const ImageView& input, const KernelSpectrum& kernel, ImageRGBA& output)
+{
+    const uint32_t kernel_width = (kernel.width - 1) * 2;
+    const uint32_t kernel_height = kernel.height;
+    if (input.width > kernel_width || input.height > kernel_height)
+    {
+        printf("input size (%ux%u) does not fit the kernel size (%ux%u).\n", input.width,
+               input.height, kernel_width, kernel_height);
+        return false;
+    }
+
+    ComplexRGB image{};
+
+    /* Circular convolution, the input is transformed as it is */
+    if (input.width == kernel_width && input.height == kernel_height)
+    {
+        /* Bring Input Image to Freq Domain */
+        fft_2d_real(input, image);
+
+        /* Multiply (in Freq Domain) */
+        freq_multiply(image, kernel);
+
+        /* Bring Input Image back to Spatial/Time Domain & Combine the Channels */
+        ifft_2d_real(image, output);
+        return true;
+    }
+
+    /* Pad the input to the kernel size by clamping its edges */
+    ImageRGBA padded(kernel_width, kernel_height);
+    for (uint32_t y = 0; y < kernel_height; ++y)
+    {
+        const uint32_t sy = clamp_index(y, input.height, kernel_height);
+        for (uint32_t x = 0; x < kernel_width; ++x)
+        {
+            const uint32_t sx = clamp_index(x, input.width, kernel_width);
+            const float* src = &input.pixels[((size_t)sy * input.width + sx) * 4];
+            std::copy(src, src + 4, &padded.pixels[((size_t)y * kernel_width + x) * 4]);
+        }
+    }
+
+    fft_2d_real(padded, image);
+    freq_multiply(image, kernel);
+    ifft_2d_real(image, padded);
+
+    /* Crop the result back to the input size */
+    output.resize(input.width, input.height);
+    for (uint32_t y = 0; y < input.height; ++y)
+    {
+        const float* src = &padded.pixels[(size_t)y * kernel_width * 4];
+        std::copy(src, src + (size_t)input.width * 4, &output.pixels[(size_t)y * input.width * 4]);
+    }
+    return true;
+}
+
+uint32_t tile_size(uint32_t kernel_size, uint32_t width, uint32_t height, uint32_t max_size)
+{
+    /* A tile keeps T - K pixels per axis, so this one holds the whole image */
+    const uint32_t single_tile = good_size(std::max(width, height) + kernel_size, true);
+
+    /* Every tile transforms T² pixels (T² log T work) to keep (T - K)² of them */
+    const uint32_t step = std::max(kernel_size / 4, 2u);
+    uint32_t best = good_size(kernel_size + step, true);
+    float best_cost = std::numeric_limits<float>::max();
+    for (uint32_t n = kernel_size + step; n <= kernel_size * 8; n += step)
+    {
+        const uint32_t size = good_size(n, true);
+        if (size > max_size && best_cost != std::numeric_limits<float>::max())
+            break;
+
+        const float kept = (float)(size - kernel_size);
+        const float cost = (float)size * (float)size * std::log2((float)size) / (kept * kept);
+        if (cost < best_cost)
+        {
+            best = size;
+            best_cost = cost;
+        }
+    }
+    return std::min(best, single_tile);
+}
+
+/* Transform Buffers of One Tile, Handed From Tile to Tile */
+struct TileScratch
+{
+    ImageRGBA tile{};
+    ComplexRGB spectrum{};
+};
+
+bool convolve_tiled(const ImageView& input, const KernelSpectrum& kernel, uint32_t kernel_size,
+                    const RowsFn& rows)
+{
+    const uint32_t tile = (kernel.width - 1) * 2;
+    if (kernel.height != tile || tile <= kernel_size)
+    {
+        printf("the tile size (%ux%u) has to be square & larger than the kernel size (%u).\n",
+               tile, kernel.height, kernel_size);
+        return false;
+    }
+
+    /* Output pixel u needs the input from u - K / 2 + 1 to u + K / 2, so each tile keeps T - K */
+    const uint32_t apron = kernel_size / 2;
+    const uint32_t block = tile - kernel_size;
+    const uint32_t tiles_x = (input.width + block - 1) / block;
+
+    std::vector<float> band((size_t)input.width * block * 4);
+
+    /*
+     * Tiles run as pool tasks & their transforms run nested parallel_for calls. Those rely on the
+     * pool's contract that a waiting caller only runs its own job's chunks, otherwise a thread
+     * could start a second tile over the first one's per-thread FFT scratch planes. The tile
+     * buffers are handed out per task instead, as several tiles can run on one thread in turn.
+     */
+    std::mutex scratch_mutex{};
+    std::vector<std::unique_ptr<TileScratch>> free_scratch{};
+    for (uint32_t band_y = 0; band_y < input.height; band_y += block)
+    {
+        const uint32_t band_rows = std::min(block, input.height - band_y);
+
+        get_thread_pool().parallel_for(tiles_x, 1, [&](size_t begin, size_t end) {
+            std::unique_ptr<TileScratch> scratch{};
+            {
+                std::lock_guard lock(scratch_mutex);
+                if (!free_scratch.empty())
+                {
+                    scratch = std::move(free_scratch.back());
+                    free_scratch.pop_back();
+                }
+            }
+            if (!scratch)
+                scratch = std::make_unique<TileScratch>();
+            ImageRGBA& tile_img = scratch->tile;
+            tile_img.resize(tile, tile);
+
+            for (size_t t = begin; t < end; ++t)
+            {
+                const uint32_t block_x = (uint32_t)t * block;
+                const uint32_t block_cols = std::min(block, input.width - block_x);
+
+                /* Gather the block & its apron, clamping at the image edges */
+                for (uint32_t y = 0; y < tile; ++y)
+                {
+                    const int64_t sy = std::clamp<int64_t>((int64_t)band_y + y - apron, 0,
+                                                           (int64_t)input.height - 1);
+                    const float* src_row = input.pixels + (size_t)sy * input.width * 4;
+                    float* dst = &tile_img.pixels[(size_t)y * tile * 4];
+                    for (uint32_t x = 0; x < tile; ++x, dst += 4)
+                    {
+                        const int64_t sx = std::clamp<int64_t>((int64_t)block_x + x - apron, 0,
+                                                               (int64_t)input.width - 1);
+                        std::copy(src_row + sx * 4, src_row + sx * 4 + 4, dst);
+                    }
+                }
+
+                fft_2d_real(tile_img, scratch->spectrum);
+                freq_multiply(scratch->spectrum, kernel);
+                ifft_2d_real(scratch->spectrum, tile_img);
+
+                /* Keep the block, the apron has wrapped around */
+                for (uint32_t y = 0; y < band_rows; ++y)
+                {
+                    const float* src = &tile_img.pixels[((size_t)(y + apron) * tile + apron) * 4];
+                    float* dst = &band[((size_t)y * input.width + block_x) * 4];
+                    std::copy(src, src + (size_t)block_cols * 4, dst);
+                }
+            }
+
+            std::lock_guard lock(scratch_mutex);
+            free_scratch.push_back(std::move(scratch));
+        });
+
+        rows(band.data(), (size_t)input.width * 4, band_y, band_rows);
+    }
+    return true;
+}
+
+bool convolve_tiled(const ImageView& input, const KernelSpectrum& kernel, uint32_t kernel_size,
+                    ImageRGBA& output)
+{
+    output.resize(input.width, input.height);
+    return convolve_tiled(input, kernel, kernel_size,
+                          [&](const float* src, size_t row_stride, uint32_t y, uint32_t count) {
+                              for (uint32_t i = 0; i < count; ++i)
+                                  std::copy(src + i * row_stride,
+                                            src + i * row_stride + (size_t)input.width * 4,
+                                            &output.pixels[(size_t)(y + i) * input.width * 4]);
+                          });
+}
+
+} // namespace fft
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <functional>
+
+#include "fft.hpp"
+
+/* CPU Implementation of the Convolution Chain in Renderer::update */
+namespace fft
+{
+
+/* Parameters of the Polygonal Aperture (Defaults Match aperture_mask.cs.slang) */
+struct ApertureParams
+{
+    uint32_t num_blades = 6; /* 5 = pentagon, 6 = hexagon, etc. */
+    float radius = 0.1f;     /* Aperture radius in UV space (0-0.5) */
+    float rotation = 0.0f;   /* Rotation in radians */
+
+    bool operator==(const ApertureParams& other) const = default;
+};
+
+/*
+ * Gaussian Glow Layered Beneath the Aperture Bloom (Defaults Match gen_gauss_kernel.cs.slang):
+ * the kernel becomes (1 - weight) * aperture + weight * gaussian, so 0 is aperture only & 1 is the
+ * Gaussian alone, which skips building the aperture kernel altogether.
+ */
+struct GlowParams
+{
+    float sigma = 10.0f; /* Standard deviation in pixels of the transform */
+    float weight = 0.0f;
+
+    bool operator==(const GlowParams& other) const = default;
+};
+
+/* Read-Only View of RGBA32F Pixels, e.g. of an ImageRGBA or a Mapped File (io::ImageFile) */
+struct ImageView
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const float* pixels = nullptr;
+};
+
+/* An RGBA32F Image (Same Layout as stbi_loadf with 4 Channels) */
+struct ImageRGBA
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> pixels{};
+
+    ImageRGBA() = default;
+    ImageRGBA(uint32_t width, uint32_t height);
+
+    void resize(uint32_t width, uint32_t height);
+
+    operator ImageView() const { return {width, height, pixels.data()}; }
+};
+
+/* How the Colour Channels are Packed Into Transforms */
+enum class Packing
+{
+    REAL,  /* One real-to-complex transform per channel */
+    PAIRED /* R + iG share one complex transform (split afterwards), B gets a real-to-complex one */
+};
+
+/* Selects the Packing Used by fft_2d_real & ifft_2d_real on Images (REAL by Default) */
+void set_packing(Packing packing);
+
+Packing get_packing();
+
+/* CPU Counterpart of the Renderer's ComplexRGB (One Half Spectrum per Colour Channel) */
+struct ComplexRGB
+{
+    ComplexPlane r{};
+    ComplexPlane g{};
+    ComplexPlane b{};
+
+    void resize(uint32_t width, uint32_t height);
+};
+
+/*
+ * Spectrum of a Convolution Kernel. Every kernel built here comes from a real, centrosymmetric PSF,
+ * so its spectrum is real & the same in every channel: one half spectrum of real values replaces
+ * 3 complex planes (the CPU counterpart of the renderer's packed kernel_img, row-major here).
+ */
+struct KernelSpectrum
+{
+    uint32_t width = 0; /* Of the half spectrum, transform width / 2 + 1 */
+    uint32_t height = 0;
+    AlignedVector<float> values{};
+
+    /* Resizes the Spectrum and Clears it to Zero */
+    void resize(uint32_t width, uint32_t height);
+
+    float* row(uint32_t y) { return values.data() + (size_t)y * width; }
+    const float* row(uint32_t y) const { return values.data() + (size_t)y * width; }
+};
+
+/* Generates the Aperture Mask (aperture_mask.cs) */
+void aperture_mask(const ApertureParams& params, uint32_t size, ImageRGBA& output);
+
+/* Brings the RGB Channels of the Image to the Frequency Domain as Half Spectra (real_fft.cs) */
+void fft_2d_real(const ImageView& input, ComplexRGB& output);
+
+/*
+ * Brings Half Spectra Back to the Spatial Domain & Combines Them Into the Final RGBA Image
+ * (real_ifft.cs & recombine_rgb.cs), the Spectra are Overwritten.
+ */
+void ifft_2d_real(ComplexRGB& image, ImageRGBA& output);
+
+/* Turns the Aperture Half Spectrum Into the Normalised (Full Size) PSF Image (compute_psf.cs) */
+void compute_psf(const ComplexRGB& aperture, const ApertureParams& params, ImageRGBA& psf);
+
+/* Multiplies the Image Spectrum With the (Real) Kernel Spectrum in Place (freq_multiply.cs) */
+void freq_multiply(ComplexRGB& image, const KernelSpectrum& kernel);
+
+/*
+ * Produces the Frequency-Domain Kernel of Aperture -> FFT -> PSF -> FFT, Computed Directly as the
+ * Autocorrelation of the Aperture (Wiener-Khinchin) With One Real FFT Pair of a Single Channel.
+ */
+void build_kernel(const ApertureParams& params, uint32_t size, KernelSpectrum& kernel);
+
+/*
+ * Writes the Spectrum of a Normalised Gaussian PSF for a width x height Transform Directly: the
+ * Fourier transform of a Gaussian is a Gaussian too, so there is no PSF image & no forward FFT.
+ * The spectrum is separable, one 1D table per axis multiplied together in a single pass.
+ */
+void gaussian_kernel(float sigma, uint32_t width, uint32_t height, KernelSpectrum& kernel);
+
+/* Blends the Glow Into a Kernel Spectrum in Place (One Pointwise Pass, Nothing if weight is 0) */
+void add_glow(const GlowParams& glow, KernelSpectrum& kernel);
+
+/*
+ * Picks the Transform Size for a width x height Image & a Kernel of kernel_size: the cheapest
+ * smooth (even) size covering the image plus the kernel support, so nothing wraps around the edges.
+ */
+void convolution_size(uint32_t width, uint32_t height, uint32_t kernel_size, uint32_t& padded_width,
+                      uint32_t& padded_height);
+
+/* Like build_kernel, With the Kernel Embedded in a padded_width x padded_height Transform */
+void build_kernel(const ApertureParams& params, uint32_t size, uint32_t padded_width,
+                  uint32_t padded_height, KernelSpectrum& kernel);
+
+/*
+ * Convolves the Input Image With a Kernel Spectrum From build_kernel.
+ * If the kernel matches the input size the convolution wraps around (like the GPU path), if it is
+ * larger (see convolution_size) the input is padded by clamping its edges and cropped afterwards.
+ * Returns false if the kernel is smaller than the input.
+ */
+bool convolve(const ImageView& input, const KernelSpectrum& kernel, ImageRGBA& output);
+
+/*
+ * Picks the Tile Size for convolve_tiled: the smooth (even) transform size with the least work per
+ * output pixel for a kernel of kernel_size, at most max_size (unless the kernel needs more). It is
+ * clamped to a single tile covering the width x height image, smaller images are not padded to it.
+ */
+uint32_t tile_size(uint32_t kernel_size, uint32_t width, uint32_t height,
+                   uint32_t max_size = 4096);
+
+/* Receives count Finished RGBA32F Rows Starting at Row y, row_stride Floats Apart */
+using RowsFn =
+    std::function<void(const float* rows, size_t row_stride, uint32_t y, uint32_t count)>;
+
+/*
+ * Convolves an Image of Any Size in Tiles (Overlap-Save), Reusing One Kernel Spectrum From
+ * build_kernel(params, kernel_size, tile, tile) for every tile. Each tile reads its block plus a
+ * kernel_size / 2 apron (clamped at the image edges like convolve) & keeps the block, which the
+ * apron makes exact. The tiles of a band run in parallel, finished bands go to `rows` top to
+ * bottom, so memory is bounded by the tile size & the image width rather than the image size.
+ * Returns false if the tile is not larger than the kernel.
+ */
+bool convolve_tiled(const ImageView& input, const KernelSpectrum& kernel, uint32_t kernel_size,
+                    const RowsFn& rows);
+
+/* Like Above, Collecting the Rows in the Output Image */
+bool convolve_tiled(const ImageView& input, const KernelSpectrum& kernel, uint32_t kernel_size,
+                    ImageRGBA& output);
+
+} // namespace fft
@@ -0,0 +1,866 @@
+#include "fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "kernels.hpp"
+#include "static_plan.hpp"
+#include "thread_pool.hpp"
+
+namespace fft
+{
+
+/*
+ * Splits the Size Into Radix-8 Stages as Long as Possible (Finishing With Radix-4 or Radix-2),
+ * Followed by the Odd Radices, so Those Run at Strides That Are Multiples of the Vector Width.
+ * Returns False if a Prime Factor Above 7 is Left.
+ */
+static bool factorize(uint32_t size, std::vector<uint32_t>& radices)
+{
+    radices.clear();
+
+    uint32_t log_size = 0;
+    while (size % 2 == 0)
+    {
+        size /= 2;
+        ++log_size;
+    }
+
+    for (uint32_t i = 0; i + 3 <= log_size; i += 3)
+        radices.push_back(8);
+    if (log_size % 3 == 1)
+    {
+        if (radices.empty())
+            radices.push_back(2);
+        else
+        {
+            radices.back() = 4;
+            radices.push_back(4);
+        }
+    }
+    else if (log_size % 3 == 2)
+        radices.push_back(4);
+
+    for (const uint32_t radix : {3u, 5u, 7u})
+    {
+        while (size % radix == 0)
+        {
+            size /= radix;
+            radices.push_back(radix);
+        }
+    }
+
+    return size == 1;
+}
+
+/*
+ * Rough Cost per Point of a Stage, Used to Pick Padded Sizes.
+ * Measured on AVX2: Odd Radices Are Far Slower Than Their Flop Count Suggests,
+ * and Stages at a Stride Below the Vector Width Fall Back to Scalar Code.
+ */
+static float stage_cost(uint32_t radix, uint32_t stride)
+{
+    float cost = 2.5f;
+    switch (radix)
+    {
+    case 2:
+        cost = 1.0f;
+        break;
+    case 3:
+        cost = 3.5f;
+        break;
+    case 4:
+        cost = 1.75f;
+        break;
+    case 5:
+        cost = 4.5f;
+        break;
+    case 7:
+        cost = 5.5f;
+        break;
+    default:
+        break;
+    }
+
+    /* The first radix-8 stage has its own vector kernel */
+    const bool vectorized = stride >= 8 || (stride == 1 && radix == 8);
+    return vectorized ? cost : cost * 3.0f;
+}
+
+/* Radix Stages & Twiddle Tables for a Single Transform Length and Direction */
+struct Schedule
+{
+    std::vector<Stage> stages{};
+    AlignedVector<float> twiddle_re{};
+    AlignedVector<float> twiddle_im{};
+
+    Schedule() = default;
+
+    /* The size has to factorize into 2, 3, 5 & 7 */
+    Schedule(uint32_t size, Direction direction)
+    {
+        std::vector<uint32_t> radices{};
+        factorize(size, radices);
+
+        /* Stage k of radix r covers sub-sequences of length n = size / stride */
+        size_t twiddle_count = 0;
+        uint32_t stride = 1;
+        for (const uint32_t radix : radices)
+        {
+            Stage stage{};
+            stage.radix = radix;
+            stage.stride = stride;
+            stage.count = size / stride / radix;
+            stages.push_back(stage);
+
+            twiddle_count += (size_t)(radix - 1) * stage.count;
+            stride *= radix;
+        }
+
+        twiddle_re.resize(twiddle_count);
+        twiddle_im.resize(twiddle_count);
+
+        const double two_pi = 6.283185307179586;
+        const double sign = direction == Direction::INVERSE ? 1.0 : -1.0;
+        size_t offset = 0;
+        for (Stage& stage : stages)
+        {
+            const uint32_t length = stage.radix * stage.count;
+            for (uint32_t k = 1; k < stage.radix; ++k)
+            {
+                for (uint32_t p = 0; p < stage.count; ++p)
+                {
+                    const double angle = sign * two_pi * (double)(p * k) / (double)length;
+                    twiddle_re[offset + (k - 1) * stage.count + p] = (float)std::cos(angle);
+                    twiddle_im[offset + (k - 1) * stage.count + p] = (float)std::sin(angle);
+                }
+            }
+
+            stage.twiddle_re = twiddle_re.data() + offset;
+            stage.twiddle_im = twiddle_im.data() + offset;
+            offset += (size_t)(stage.radix - 1) * stage.count;
+        }
+    }
+};
+
+/* Per-Thread Buffers for the Kernels (Kept Around Between Transforms) */
+struct Scratch
+{
+    AlignedVector<float> re{};
+    AlignedVector<float> im{};
+    AlignedVector<float> column_re{};
+    AlignedVector<float> column_im{};
+};
+
+static Scratch& get_scratch(uint32_t size)
+{
+    static thread_local Scratch scratch{};
+    if (scratch.re.size() < size)
+    {
+        scratch.re.resize(size);
+        scratch.im.resize(size);
+        scratch.column_re.resize(size);
+        scratch.column_im.resize(size);
+    }
+    return scratch;
+}
+
+/*
+ * Transforms Rows of a Single Length and Direction.
+ * Sizes made of 2, 3, 5 & 7 run the Stockham stages directly, any other size goes through
+ * Bluestein's algorithm: X[k] = w[k] * sum(x[n] * w[n] * conj(w[k - n])), w[n] = e^(-iπn²/N),
+ * a convolution evaluated with transforms of a padded (smooth) size.
+ */
+struct RowTransform
+{
+    uint32_t size = 0;
+    Direction direction = Direction::FORWARD;
+    bool fixed = false; /* Runs the compile-time kernel of a static size */
+    Schedule schedule{};
+
+    bool bluestein = false;
+    uint32_t padded = 0;
+    Schedule padded_forward{};
+    Schedule padded_inverse{};
+    AlignedVector<float> chirp_re{};  /* w[n] (conjugated for inverse) */
+    AlignedVector<float> chirp_im{};
+    AlignedVector<float> filter_re{}; /* FFT of conj(w[n]), wrapped around to the padded size */
+    AlignedVector<float> filter_im{};
+
+    RowTransform() = default;
+
+    RowTransform(uint32_t size, Direction direction) : size(size), direction(direction)
+    {
+        if (is_static_size(size))
+        {
+            fixed = true;
+            return;
+        }
+
+        std::vector<uint32_t> radices{};
+        if (factorize(size, radices))
+        {
+            schedule = Schedule(size, direction);
+            return;
+        }
+
+        bluestein = true;
+        padded = good_size(2 * size - 1);
+        padded_forward = Schedule(padded, Direction::FORWARD);
+        padded_inverse = Schedule(padded, Direction::INVERSE);
+
+        /* n² mod 2N keeps the chirp angle accurate for large n */
+        const double pi = 3.141592653589793;
+        const double sign = direction == Direction::INVERSE ? 1.0 : -1.0;
+        chirp_re.resize(size);
+        chirp_im.resize(size);
+        for (uint32_t n = 0; n < size; ++n)
+        {
+            const uint64_t n2 = ((uint64_t)n * n) % (2ull * size);
+            const double angle = sign * pi * (double)n2 / (double)size;
+            chirp_re[n] = (float)std::cos(angle);
+            chirp_im[n] = (float)std::sin(angle);
+        }
+
+        filter_re.assign(padded, 0.0f);
+        filter_im.assign(padded, 0.0f);
+        for (uint32_t n = 0; n < size; ++n)
+        {
+            filter_re[n] = chirp_re[n];
+            filter_im[n] = -chirp_im[n];
+            if (n > 0)
+            {
+                filter_re[padded - n] = chirp_re[n];
+                filter_im[padded - n] = -chirp_im[n];
+            }
+        }
+
+        Scratch& scratch = get_scratch(padded);
+        get_kernels().transform_rows(filter_re.data(), filter_im.data(), padded, 1, padded,
+                                     padded_forward.stages.data(),
+                                     (uint32_t)padded_forward.stages.size(), Direction::FORWARD,
+                                     scratch.re.data(), scratch.im.data());
+    }
+
+    /* Transforms `rows` rows in place (rows are `row_stride` floats apart) */
+    void run(float* re, float* im, size_t row_stride, uint32_t rows) const
+    {
+        if (fixed)
+        {
+            static_transform_rows(size, re, im, row_stride, rows, direction);
+            return;
+        }
+
+        const Kernels& kernels = get_kernels();
+        if (!bluestein)
+        {
+            Scratch& scratch = get_scratch(size);
+            kernels.transform_rows(re, im, row_stride, rows, size, schedule.stages.data(),
+                                   (uint32_t)schedule.stages.size(), direction,
+                                   scratch.re.data(), scratch.im.data());
+            return;
+        }
+
+        /* The column buffers hold the padded sequence, the others are the kernel scratch */
+        Scratch& scratch = get_scratch(padded);
+        float* work_re = scratch.column_re.data();
+        float* work_im = scratch.column_im.data();
+        const float scale = direction == Direction::INVERSE ? 1.0f / (float)size : 1.0f;
+
+        for (uint32_t y = 0; y < rows; ++y)
+        {
+            float* row_re = re + y * row_stride;
+            float* row_im = im + y * row_stride;
+
+            /* a[n] = x[n] * w[n], zero padded */
+            for (uint32_t n = 0; n < size; ++n)
+            {
+                work_re[n] = row_re[n] * chirp_re[n] - row_im[n] * chirp_im[n];
+                work_im[n] = row_re[n] * chirp_im[n] + row_im[n] * chirp_re[n];
+            }
+            std::fill(work_re + size, work_re + padded, 0.0f);
+            std::fill(work_im + size, work_im + padded, 0.0f);
+
+            /* Circular convolution with the filter */
+            kernels.transform_rows(work_re, work_im, padded, 1, padded,
+                                   padded_forward.stages.data(),
+                                   (uint32_t)padded_forward.stages.size(), Direction::FORWARD,
+                                   scratch.re.data(), scratch.im.data());
+            for (uint32_t k = 0; k < padded; ++k)
+            {
+                const float a = work_re[k];
+                const float b = work_im[k];
+                work_re[k] = a * filter_re[k] - b * filter_im[k];
+                work_im[k] = a * filter_im[k] + b * filter_re[k];
+            }
+            kernels.transform_rows(work_re, work_im, padded, 1, padded,
+                                   padded_inverse.stages.data(),
+                                   (uint32_t)padded_inverse.stages.size(), Direction::INVERSE,
+                                   scratch.re.data(), scratch.im.data());
+
+            /* X[k] = w[k] * (a * filter)[k] */
+            for (uint32_t k = 0; k < size; ++k)
+            {
+                row_re[k] = (work_re[k] * chirp_re[k] - work_im[k] * chirp_im[k]) * scale;
+                row_im[k] = (work_re[k] * chirp_im[k] + work_im[k] * chirp_re[k]) * scale;
+            }
+        }
+    }
+};
+
+/* Twiddles W^k = e^(-2πik/N) for k <= N/4, Used to Split/Merge the Packed Half-Length Transform */
+struct RealTwiddles
+{
+    AlignedVector<float> re{};
+    AlignedVector<float> im{};
+
+    RealTwiddles() = default;
+
+    explicit RealTwiddles(uint32_t size)
+    {
+        const uint32_t count = size / 4 + 1;
+        re.resize(count);
+        im.resize(count);
+
+        const double two_pi = 6.283185307179586;
+        for (uint32_t k = 0; k < count; ++k)
+        {
+            const double angle = -two_pi * (double)k / (double)size;
+            re[k] = (float)std::cos(angle);
+            im[k] = (float)std::sin(angle);
+        }
+    }
+};
+
+/*
+ * Turns Z = FFT(x[2n] + i * x[2n + 1]) (first `half` entries of the row) into the half spectrum
+ * X[0..half] of x, in place:
+ *   E[k] = (Z[k] + conj(Z[half - k])) / 2, O[k] = -i * (Z[k] - conj(Z[half - k])) / 2
+ *   X[k] = E[k] + W^k * O[k], X[half - k] = conj(E[k] - W^k * O[k])
+ */
+static void split_real(float* re, float* im, uint32_t half, const RealTwiddles& twiddles)
+{
+    const float z0_re = re[0];
+    const float z0_im = im[0];
+    re[0] = z0_re + z0_im;
+    im[0] = 0.0f;
+    re[half] = z0_re - z0_im;
+    im[half] = 0.0f;
+
+    for (uint32_t k = 1; k <= half / 2; ++k)
+    {
+        const uint32_t j = half - k;
+        const float e_re = 0.5f * (re[k] + re[j]);
+        const float e_im = 0.5f * (im[k] - im[j]);
+        const float o_re = 0.5f * (im[k] + im[j]);
+        const float o_im = -0.5f * (re[k] - re[j]);
+
+        const float w_re = twiddles.re[k];
+        const float w_im = twiddles.im[k];
+        const float wo_re = w_re * o_re - w_im * o_im;
+        const float wo_im = w_re * o_im + w_im * o_re;
+
+        re[k] = e_re + wo_re;
+        im[k] = e_im + wo_im;
+        re[j] = e_re - wo_re;
+        im[j] = wo_im - e_im;
+    }
+}
+
+/*
+ * Inverse of split_real, turns the half spectrum X[0..half] back into Z (first `half` entries):
+ *   E[k] = (X[k] + conj(X[half - k])) / 2, O[k] = (X[k] - conj(X[half - k])) / 2 * conj(W^k)
+ *   Z[k] = E[k] + i * O[k], Z[half - k] = conj(E[k] - i * O[k])
+ */
+static void merge_real(float* re, float* im, uint32_t half, const RealTwiddles& twiddles)
+{
+    const float x0_re = re[0], x0_im = im[0];
+    const float xn_re = re[half], xn_im = im[half];
+    re[0] = 0.5f * (x0_re + xn_re - x0_im - xn_im);
+    im[0] = 0.5f * (x0_re - xn_re + x0_im - xn_im);
+
+    for (uint32_t k = 1; k <= half / 2; ++k)
+    {
+        const uint32_t j = half - k;
+        const float e_re = 0.5f * (re[k] + re[j]);
+        const float e_im = 0.5f * (im[k] - im[j]);
+        const float d_re = 0.5f * (re[k] - re[j]);
+        const float d_im = 0.5f * (im[k] + im[j]);
+
+        const float w_re = twiddles.re[k];
+        const float w_im = -twiddles.im[k];
+        const float o_re = d_re * w_re - d_im * w_im;
+        const float o_im = d_re * w_im + d_im * w_re;
+
+        re[k] = e_re - o_im;
+        im[k] = e_im + o_re;
+        re[j] = e_re + o_im;
+        im[j] = o_re - e_im;
+    }
+}
+
+struct Plan
+{
+    PlanKey key{};
+
+    RowTransform rows{};      /* width point transform */
+    RowTransform columns{};   /* height point transform */
+    RowTransform half_rows{}; /* width / 2 point transform, for the real transforms (even widths) */
+    RealTwiddles real_twiddles{};
+
+    explicit Plan(const PlanKey& key)
+        : key(key), rows(key.width, key.direction), columns(key.height, key.direction)
+    {
+        if (is_supported_real_size(key.width))
+        {
+            half_rows = RowTransform(key.width / 2, key.direction);
+            real_twiddles = RealTwiddles(key.width);
+        }
+    }
+};
+
+/* Plans of Every Thread, Most Recently Used First */
+struct PlanCache
+{
+    using Order = std::list<std::pair<PlanKey, std::shared_ptr<const Plan>>>;
+
+    std::mutex mutex{};
+    Order order{};
+    std::unordered_map<PlanKey, Order::iterator, PlanKeyHash> entries{};
+};
+
+static PlanCache& get_plan_cache()
+{
+    static PlanCache cache{};
+    return cache;
+}
+
+/*
+ * Per-Thread Planes of the 2D Transforms (Column Passes & Paired Real Transforms), Reused Across
+ * Sizes. A thread waiting inside a transform only runs chunks of its own job (see ThreadPool), so
+ * nothing else runs over them in the meantime.
+ */
+struct PlaneScratch
+{
+    ComplexPlane transposed{};
+    ComplexPlane packed{};
+};
+
+static PlaneScratch& get_plane_scratch()
+{
+    static thread_local PlaneScratch scratch{};
+    return scratch;
+}
+
+/* Splits a batch into ~4 chunks per thread, so stealing can even out the load */
+static size_t get_grain(size_t count, const ThreadPool& pool)
+{
+    return std::max<size_t>(1, count / ((size_t)pool.get_thread_count() * 4));
+}
+
+ComplexPlane::ComplexPlane(uint32_t width, uint32_t height)
+{
+    resize(width, height);
+}
+
+void ComplexPlane::resize(uint32_t new_width, uint32_t new_height)
+{
+    width = new_width;
+    height = new_height;
+    re.assign((size_t)width * height, 0.0f);
+    im.assign((size_t)width * height, 0.0f);
+}
+
+void static_transform_rows(uint32_t size, float* re, float* im, size_t row_stride, uint32_t rows,
+                           Direction direction)
+{
+    Scratch& scratch = get_scratch(size);
+    get_kernels().static_transform_rows[static_size_index(size)](
+        re, im, row_stride, rows, direction, scratch.re.data(), scratch.im.data());
+}
+
+std::shared_ptr<const Plan> get_plan(const PlanKey& key)
+{
+    PlanCache& cache = get_plan_cache();
+    {
+        std::lock_guard lock(cache.mutex);
+        const auto it = cache.entries.find(key);
+        if (it != cache.entries.end())
+        {
+            cache.order.splice(cache.order.begin(), cache.order, it->second);
+            return it->second->second;
+        }
+    }
+
+    /* Built outside the lock, a thread building another size is not held up */
+    std::shared_ptr<const Plan> plan = std::make_shared<const Plan>(key);
+
+    std::lock_guard lock(cache.mutex);
+    const auto it = cache.entries.find(key);
+    if (it != cache.entries.end())
+    {
+        /* Another thread got there first, its plan is the one everyone shares */
+        cache.order.splice(cache.order.begin(), cache.order, it->second);
+        return it->second->second;
+    }
+
+    cache.order.emplace_front(key, plan);
+    cache.entries[key] = cache.order.begin();
+    if (cache.order.size() > MAX_CACHED_PLANS)
+    {
+        cache.entries.erase(cache.order.back().first);
+        cache.order.pop_back();
+    }
+    return plan;
+}
+
+size_t get_plan_count()
+{
+    PlanCache& cache = get_plan_cache();
+    std::lock_guard lock(cache.mutex);
+    return cache.order.size();
+}
+
+void clear_plans()
+{
+    PlanCache& cache = get_plan_cache();
+    {
+        std::lock_guard lock(cache.mutex);
+        cache.entries.clear();
+        cache.order.clear();
+    }
+    get_plane_scratch() = PlaneScratch{};
+}
+
+bool is_supported_size(uint32_t size)
+{
+    return size > 0;
+}
+
+bool is_supported_real_size(uint32_t size)
+{
+    return size >= 2 && size % 2 == 0;
+}
+
+bool is_smooth_size(uint32_t size)
+{
+    std::vector<uint32_t> radices{};
+    return size > 0 && factorize(size, radices);
+}
+
+uint32_t good_size(uint32_t min_size, bool even)
+{
+    if (min_size <= 1)
+        return even ? 2 : 1;
+
+    /* The next power of two is always a candidate, so nothing above it has to be considered */
+    uint64_t limit = 1;
+    while (limit < min_size)
+        limit *= 2;
+
+    uint32_t best = (uint32_t)limit;
+    float best_cost = std::numeric_limits<float>::max();
+    std::vector<uint32_t> radices{};
+    for (uint64_t p7 = 1; p7 <= limit; p7 *= 7)
+        for (uint64_t p5 = p7; p5 <= limit; p5 *= 5)
+            for (uint64_t p3 = p5; p3 <= limit; p3 *= 3)
+                for (uint64_t size = p3; size <= limit; size *= 2)
+                {
+                    if (size < min_size || (even && size % 2 != 0))
+                        continue;
+
+                    factorize((uint32_t)size, radices);
+                    float cost = 0.0f;
+                    uint32_t stride = 1;
+                    for (const uint32_t radix : radices)
+                    {
+                        cost += stage_cost(radix, stride);
+                        stride *= radix;
+                    }
+                    cost *= (float)size;
+
+                    if (cost < best_cost || (cost == best_cost && size < best))
+                    {
+                        best = (uint32_t)size;
+                        best_cost = cost;
+                    }
+                }
+    return best;
+}
+
+/* Runs a Row Transform Over Every Row of the Plane */
+static void run_rows(const RowTransform& transform, ComplexPlane& plane)
+{
+    ThreadPool& pool = get_thread_pool();
+
+    /* Every row is independent, so batches of rows are spread over the pool */
+    pool.parallel_for(plane.height, get_grain(plane.height, pool), [&](size_t begin, size_t end) {
+        transform.run(plane.row_re((uint32_t)begin), plane.row_im((uint32_t)begin), plane.width,
+                      (uint32_t)(end - begin));
+    });
+}
+
+/* Runs a Row Transform Over Every Column of the Plane */
+static void run_columns(const RowTransform& transform, ComplexPlane& plane,
+                        ComplexPlane& transposed)
+{
+    /* Strided column access would miss the cache on every element, so the columns are
+     * transposed into contiguous rows, transformed, and transposed back */
+    transpose(plane, transposed);
+    run_rows(transform, transposed);
+    transpose(transposed, plane);
+}
+
+void fft_rows(ComplexPlane& plane, Direction direction)
+{
+    const std::shared_ptr<const Plan> plan =
+        get_plan({plane.width, plane.height, Precision::SINGLE, direction});
+    run_rows(plan->rows, plane);
+}
+
+void fft_columns(ComplexPlane& plane, Direction direction)
+{
+    const std::shared_ptr<const Plan> plan =
+        get_plan({plane.width, plane.height, Precision::SINGLE, direction});
+    run_columns(plan->columns, plane, get_plane_scratch().transposed);
+}
+
+void transpose(const ComplexPlane& src, ComplexPlane& dst)
+{
+    if (dst.width != src.height || dst.height != src.width)
+        dst.resize(src.height, src.width);
+
+    const Kernels& kernels = get_kernels();
+    ThreadPool& pool = get_thread_pool();
+
+    /* Bands of 32 source rows, each task writes a disjoint band of destination columns */
+    const uint32_t band = 32;
+    const size_t bands = (src.height + band - 1) / band;
+    pool.parallel_for(bands, get_grain(bands, pool), [&](size_t begin, size_t end) {
+        const uint32_t y0 = (uint32_t)begin * band;
+        const uint32_t y1 = std::min((uint32_t)end * band, src.height);
+        kernels.transpose(src.row_re(y0), src.width, dst.re.data() + y0, dst.width, src.width,
+                          y1 - y0);
+        kernels.transpose(src.row_im(y0), src.width, dst.im.data() + y0, dst.width, src.width,
+                          y1 - y0);
+    });
+}
+
+void fft_2d(ComplexPlane& plane, Direction direction)
+{
+    const std::shared_ptr<const Plan> plan =
+        get_plan({plane.width, plane.height, Precision::SINGLE, direction});
+    run_columns(plan->columns, plane, get_plane_scratch().transposed);
+    run_rows(plan->rows, plane);
+}
+
+void fft_2d_real(const float* src, uint32_t width, uint32_t height, size_t pixel_stride,
+                 size_t row_stride, ComplexPlane& spectrum)
+{
+    const uint32_t half = width / 2;
+    if (spectrum.width != half + 1 || spectrum.height != height)
+        spectrum.resize(half + 1, height);
+
+    const std::shared_ptr<const Plan> plan =
+        get_plan({width, height, Precision::SINGLE, Direction::FORWARD});
+    const RowTransform& transform = plan->half_rows;
+    const RealTwiddles& twiddles = plan->real_twiddles;
+    ThreadPool& pool = get_thread_pool();
+
+    /* Rows: pack even & odd samples into one half-length complex row, transform and split it */
+    pool.parallel_for(height, get_grain(height, pool), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+        {
+            const float* row = src + y * row_stride;
+            float* re = spectrum.row_re((uint32_t)y);
+            float* im = spectrum.row_im((uint32_t)y);
+            for (uint32_t n = 0; n < half; ++n)
+            {
+                re[n] = row[(2 * n) * pixel_stride];
+                im[n] = row[(2 * n + 1) * pixel_stride];
+            }
+        }
+
+        transform.run(spectrum.row_re((uint32_t)begin), spectrum.row_im((uint32_t)begin),
+                      spectrum.width, (uint32_t)(end - begin));
+
+        for (size_t y = begin; y < end; ++y)
+            split_real(spectrum.row_re((uint32_t)y), spectrum.row_im((uint32_t)y), half, twiddles);
+    });
+
+    /* Columns: only the half + 1 non-redundant ones */
+    run_columns(plan->columns, spectrum, get_plane_scratch().transposed);
+}
+
+void ifft_2d_real(ComplexPlane& spectrum, float* dst, size_t pixel_stride, size_t row_stride)
+{
+    const uint32_t half = spectrum.width - 1;
+    const uint32_t width = half * 2;
+    const uint32_t height = spectrum.height;
+
+    const std::shared_ptr<const Plan> plan =
+        get_plan({width, height, Precision::SINGLE, Direction::INVERSE});
+    const RowTransform& transform = plan->half_rows;
+    const RealTwiddles& twiddles = plan->real_twiddles;
+    ThreadPool& pool = get_thread_pool();
+
+    /* Columns first, so every row holds the half spectrum of a real row again */
+    run_columns(plan->columns, spectrum, get_plane_scratch().transposed);
+
+    /* Rows: merge back into a half-length complex row, transform and unpack it (the 1/half
+     * scale of the half-length transform is the 1/width of the real one) */
+    pool.parallel_for(height, get_grain(height, pool), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+            merge_real(spectrum.row_re((uint32_t)y), spectrum.row_im((uint32_t)y), half, twiddles);
+
+        transform.run(spectrum.row_re((uint32_t)begin), spectrum.row_im((uint32_t)begin),
+                      spectrum.width, (uint32_t)(end - begin));
+
+        for (size_t y = begin; y < end; ++y)
+        {
+            float* row = dst + y * row_stride;
+            const float* re = spectrum.row_re((uint32_t)y);
+            const float* im = spectrum.row_im((uint32_t)y);
+            for (uint32_t n = 0; n < half; ++n)
+            {
+                row[(2 * n) * pixel_stride] = re[n];
+                row[(2 * n + 1) * pixel_stride] = im[n];
+            }
+        }
+    });
+}
+
+void fft_2d_real_pair(const float* src_a, const float* src_b, uint32_t width, uint32_t height,
+                      size_t pixel_stride, size_t row_stride, ComplexPlane& spectrum_a,
+                      ComplexPlane& spectrum_b)
+{
+    const uint32_t half = width / 2;
+    if (spectrum_a.width != half + 1 || spectrum_a.height != height)
+        spectrum_a.resize(half + 1, height);
+    if (spectrum_b.width != half + 1 || spectrum_b.height != height)
+        spectrum_b.resize(half + 1, height);
+
+    const std::shared_ptr<const Plan> plan =
+        get_plan({width, height, Precision::SINGLE, Direction::FORWARD});
+    PlaneScratch& scratch = get_plane_scratch();
+    ComplexPlane& packed = scratch.packed;
+    if (packed.width != width || packed.height != height)
+        packed.resize(width, height);
+
+    ThreadPool& pool = get_thread_pool();
+
+    /* z = a + i * b */
+    pool.parallel_for(height, get_grain(height, pool), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+        {
+            const float* row_a = src_a + y * row_stride;
+            const float* row_b = src_b + y * row_stride;
+            float* re = packed.row_re((uint32_t)y);
+            float* im = packed.row_im((uint32_t)y);
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                re[x] = row_a[x * pixel_stride];
+                im[x] = row_b[x * pixel_stride];
+            }
+        }
+    });
+
+    run_columns(plan->columns, packed, scratch.transposed);
+    run_rows(plan->rows, packed);
+
+    /* Split Z into the (Hermitian) spectra of a & b, only the non-redundant columns are kept */
+    pool.parallel_for(height, get_grain(height, pool), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+        {
+            const uint32_t mirror_y = (height - (uint32_t)y) % height;
+            const float* z_re = packed.row_re((uint32_t)y);
+            const float* z_im = packed.row_im((uint32_t)y);
+            const float* m_re = packed.row_re(mirror_y);
+            const float* m_im = packed.row_im(mirror_y);
+            float* a_re = spectrum_a.row_re((uint32_t)y);
+            float* a_im = spectrum_a.row_im((uint32_t)y);
+            float* b_re = spectrum_b.row_re((uint32_t)y);
+            float* b_im = spectrum_b.row_im((uint32_t)y);
+            for (uint32_t x = 0; x <= half; ++x)
+            {
+                const uint32_t mirror_x = (width - x) % width;
+                a_re[x] = 0.5f * (z_re[x] + m_re[mirror_x]);
+                a_im[x] = 0.5f * (z_im[x] - m_im[mirror_x]);
+                b_re[x] = 0.5f * (z_im[x] + m_im[mirror_x]);
+                b_im[x] = -0.5f * (z_re[x] - m_re[mirror_x]);
+            }
+        }
+    });
+}
+
+void ifft_2d_real_pair(const ComplexPlane& spectrum_a, const ComplexPlane& spectrum_b,
+                       float* dst_a, float* dst_b, size_t pixel_stride, size_t row_stride)
+{
+    const uint32_t half = spectrum_a.width - 1;
+    const uint32_t width = half * 2;
+    const uint32_t height = spectrum_a.height;
+
+    const std::shared_ptr<const Plan> plan =
+        get_plan({width, height, Precision::SINGLE, Direction::INVERSE});
+    PlaneScratch& scratch = get_plane_scratch();
+    ComplexPlane& packed = scratch.packed;
+    if (packed.width != width || packed.height != height)
+        packed.resize(width, height);
+
+    ThreadPool& pool = get_thread_pool();
+
+    /* Z = A + i * B, the missing columns follow from A[-k] = conj(A[k]) (same for B) */
+    pool.parallel_for(height, get_grain(height, pool), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+        {
+            const uint32_t mirror_y = (height - (uint32_t)y) % height;
+            const float* a_re = spectrum_a.row_re((uint32_t)y);
+            const float* a_im = spectrum_a.row_im((uint32_t)y);
+            const float* b_re = spectrum_b.row_re((uint32_t)y);
+            const float* b_im = spectrum_b.row_im((uint32_t)y);
+            const float* ma_re = spectrum_a.row_re(mirror_y);
+            const float* ma_im = spectrum_a.row_im(mirror_y);
+            const float* mb_re = spectrum_b.row_re(mirror_y);
+            const float* mb_im = spectrum_b.row_im(mirror_y);
+            float* z_re = packed.row_re((uint32_t)y);
+            float* z_im = packed.row_im((uint32_t)y);
+            for (uint32_t x = 0; x <= half; ++x)
+            {
+                z_re[x] = a_re[x] - b_im[x];
+                z_im[x] = a_im[x] + b_re[x];
+            }
+            for (uint32_t x = half + 1; x < width; ++x)
+            {
+                const uint32_t mirror_x = width - x;
+                z_re[x] = ma_re[mirror_x] + mb_im[mirror_x];
+                z_im[x] = mb_re[mirror_x] - ma_im[mirror_x];
+            }
+        }
+    });
+
+    run_columns(plan->columns, packed, scratch.transposed);
+    run_rows(plan->rows, packed);
+
+    /* a = Re(z), b = Im(z) */
+    pool.parallel_for(height, get_grain(height, pool), [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+        {
+            float* row_a = dst_a + y * row_stride;
+            float* row_b = dst_b + y * row_stride;
+            const float* re = packed.row_re((uint32_t)y);
+            const float* im = packed.row_im((uint32_t)y);
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                row_a[x * pixel_stride] = re[x];
+                row_b[x * pixel_stride] = im[x];
+            }
+        }
+    });
+}
+
+} // namespace fft
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "aligned.hpp"
+
+/* CPU Implementation of the FFT in "assets/shaders/shared/fft_common.slang" (Any Size) */
+namespace fft
+{
+
+enum class Direction
+{
+    FORWARD,
+    INVERSE
+};
+
+/* Precision of the Transformed Data (Only Single Precision Kernels Exist so Far) */
+enum class Precision
+{
+    SINGLE
+};
+
+/* A 2D Grid of Complex Numbers, Stored as Separate Real & Imaginary Planes (Row-Major) */
+struct ComplexPlane
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    AlignedVector<float> re{};
+    AlignedVector<float> im{};
+
+    ComplexPlane() = default;
+    ComplexPlane(uint32_t width, uint32_t height);
+
+    /* Resizes the Plane and Clears it to Zero */
+    void resize(uint32_t width, uint32_t height);
+
+    float* row_re(uint32_t y) { return re.data() + (size_t)y * width; }
+    float* row_im(uint32_t y) { return im.data() + (size_t)y * width; }
+    const float* row_re(uint32_t y) const { return re.data() + (size_t)y * width; }
+    const float* row_im(uint32_t y) const { return im.data() + (size_t)y * width; }
+};
+
+/*
+ * Identifies a Plan: Transforms of width x height Grids in One Direction.
+ * For the real transforms the width is the real width, not the width of the half spectrum.
+ */
+struct PlanKey
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    Precision precision = Precision::SINGLE;
+    Direction direction = Direction::FORWARD;
+
+    bool operator==(const PlanKey& other) const = default;
+};
+
+struct PlanKeyHash
+{
+    size_t operator()(const PlanKey& key) const
+    {
+        uint64_t h = ((uint64_t)key.width << 32) | key.height;
+        h ^= ((uint64_t)key.precision << 1 | (uint64_t)key.direction) * 0x9E3779B97F4A7C15ull;
+        return (size_t)(h ^ (h >> 29));
+    }
+};
+
+/*
+ * Everything a Transform of One Key Needs: the Row & Column Schedules (or Bluestein Filters) and
+ * the Real Transform Twiddles. Immutable once built. Defined in fft.cpp.
+ */
+struct Plan;
+
+/* Plans Kept Around, the Least Recently Used One is Dropped Past This */
+constexpr size_t MAX_CACHED_PLANS = 32;
+
+/*
+ * Returns the Plan for the Key, Building it on First Use. The transforms below look their plans up
+ * here, so after warm-up a size change only costs a lookup. One cache is shared by every thread
+ * (pool workers transforming tiles reuse the same tables); the scratch planes of the transforms
+ * are per thread instead, one set for every size, so memory does not grow with sizes x threads.
+ * A plan evicted while in use stays alive until its last user is done.
+ */
+std::shared_ptr<const Plan> get_plan(const PlanKey& key);
+
+/* Number of Cached Plans */
+size_t get_plan_count();
+
+/* Drops the Cached Plans & the Calling Thread's Scratch Planes */
+void clear_plans();
+
+/* Returns True if the Size is Supported by the Transforms (Any Size Above Zero) */
+bool is_supported_size(uint32_t size);
+
+/* Returns True if the Size is Supported by the Real Transforms (Even) */
+bool is_supported_real_size(uint32_t size);
+
+/* Returns True if the Size Only Has Prime Factors 2, 3, 5 & 7 (No Bluestein Needed) */
+bool is_smooth_size(uint32_t size);
+
+/*
+ * Returns the Cheapest Smooth Size (Factors 2, 3, 5 & 7) of At Least min_size, Never More Than the
+ * Next Power of Two. Pass `even` for Sizes Used by the Real Transforms.
+ */
+uint32_t good_size(uint32_t min_size, bool even = false);
+
+/* Applies a 1D FFT to Every Row of the Plane */
+void fft_rows(ComplexPlane& plane, Direction direction);
+
+/* Applies a 1D FFT to Every Column of the Plane (as Rows of the Transposed Plane) */
+void fft_columns(ComplexPlane& plane, Direction direction);
+
+/* Writes the Transpose of the Source Plane to the Destination (Resized to Height x Width) */
+void transpose(const ComplexPlane& src, ComplexPlane& dst);
+
+/*
+ * Applies a 2D FFT to the Plane (Columns, then Rows, like Renderer::fft).
+ * Uses the same conventions as fft::apply_fft: the forward transform is unscaled,
+ * and the inverse transform is scaled by 1/N per dimension.
+ */
+void fft_2d(ComplexPlane& plane, Direction direction);
+
+/*
+ * Applies a Real-to-Complex 2D FFT to a Strided Real Image (e.g. One Channel of an RGBA Image).
+ * The spectrum of a real signal is Hermitian, so only its width / 2 + 1 non-redundant columns are
+ * kept: every row is packed as a width / 2 complex signal (even samples real, odd samples
+ * imaginary), transformed, and split into the half spectrum, then the columns are transformed.
+ */
+void fft_2d_real(const float* src, uint32_t width, uint32_t height, size_t pixel_stride,
+                 size_t row_stride, ComplexPlane& spectrum);
+
+/*
+ * Inverse of fft_2d_real (Scaled by 1/N per Dimension), the Real Width is 2 * (spectrum.width - 1).
+ * Transforms the spectrum in place, so its contents are lost.
+ */
+void ifft_2d_real(ComplexPlane& spectrum, float* dst, size_t pixel_stride, size_t row_stride);
+
+/*
+ * Applies fft_2d_real to Two Real Images at Once, Using One Complex Transform of a + i * b.
+ * The spectra are separated afterwards by their symmetric & antisymmetric parts:
+ *   A[k] = (Z[k] + conj(Z[-k])) / 2, B[k] = (Z[k] - conj(Z[-k])) / 2i
+ */
+void fft_2d_real_pair(const float* src_a, const float* src_b, uint32_t width, uint32_t height,
+                      size_t pixel_stride, size_t row_stride, ComplexPlane& spectrum_a,
+                      ComplexPlane& spectrum_b);
+
+/* Inverse of fft_2d_real_pair, Using One Complex Transform of A + i * B (Spectra are Kept) */
+void ifft_2d_real_pair(const ComplexPlane& spectrum_a, const ComplexPlane& spectrum_b,
+                       float* dst_a, float* dst_b, size_t pixel_stride, size_t row_stride);
+
+} // namespace fft
@@ -0,0 +1,192 @@
+#include "kernel_cache.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace fft
+{
+
+/* Bump When the Layout Below Changes */
+constexpr uint32_t KERNEL_FILE_VERSION = 2;
+constexpr char KERNEL_FILE_MAGIC[8] = {'L', 'U', 'C', 'E', 'O', 'K', 'R', 'N'};
+
+/* File Header, Padded to 64 Bytes so the Spectrum Starts Cache Line Aligned */
+struct KernelFileHeader
+{
+    char magic[8]{};
+    uint32_t file_version = 0;
+    uint32_t shader_version = 0;
+    uint64_t hash = 0;
+
+    uint32_t num_blades = 0;
+    float radius = 0.0f;
+    float rotation = 0.0f;
+    uint32_t size = 0;
+    uint32_t precision = 0;
+    uint32_t spectrum_width = 0;
+
+    uint64_t spectrum_bytes = 0; /* Of the packed real spectrum following the header */
+    uint8_t padding[8]{};
+};
+static_assert(sizeof(KernelFileHeader) == 64, "the spectrum should start at 64 bytes");
+
+static KernelFileHeader make_header(const KernelCacheKey& key)
+{
+    KernelFileHeader header{};
+    std::memcpy(header.magic, KERNEL_FILE_MAGIC, sizeof(header.magic));
+    header.file_version = KERNEL_FILE_VERSION;
+    header.shader_version = key.shader_version;
+    header.hash = hash_kernel_key(key);
+    header.num_blades = key.params.num_blades;
+    header.radius = key.params.radius;
+    header.rotation = key.params.rotation;
+    header.size = key.size;
+    header.precision = (uint32_t)key.precision;
+    header.spectrum_width = key.size / 2 + 1;
+    header.spectrum_bytes = (uint64_t)key.size * header.spectrum_width * sizeof(float);
+    return header;
+}
+
+static void hash_bytes(uint64_t& hash, const void* data, size_t count)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < count; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+}
+
+uint64_t hash_kernel_key(const KernelCacheKey& key)
+{
+    /* Floats are hashed by their bits, so the same slider value always maps to the same file */
+    const uint32_t precision = (uint32_t)key.precision;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash_bytes(hash, &key.params.num_blades, sizeof(key.params.num_blades));
+    hash_bytes(hash, &key.params.radius, sizeof(key.params.radius));
+    hash_bytes(hash, &key.params.rotation, sizeof(key.params.rotation));
+    hash_bytes(hash, &key.size, sizeof(key.size));
+    hash_bytes(hash, &precision, sizeof(precision));
+    hash_bytes(hash, &key.shader_version, sizeof(key.shader_version));
+    return hash;
+}
+
+std::string kernel_cache_path(const std::string& directory, const KernelCacheKey& key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "kernel_%016llx.bin", (unsigned long long)hash_kernel_key(key));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+void pack_kernel(const KernelSpectrum& kernel, std::vector<float>& spectrum)
+{
+    const uint32_t spectrum_width = kernel.width;
+    const uint32_t height = kernel.height;
+    spectrum.resize((size_t)spectrum_width * height);
+    for (uint32_t k = 0; k < spectrum_width; ++k)
+        for (uint32_t y = 0; y < height; ++y)
+            spectrum[(size_t)k * height + y] = kernel.row(y)[k];
+}
+
+bool save_kernel(const std::string& path, const KernelCacheKey& key, const KernelSpectrum& kernel)
+{
+    if (kernel.width != key.size / 2 + 1 || kernel.height != key.size)
+    {
+        printf("kernel spectrum does not match the cache key size (%u).\n", key.size);
+        return false;
+    }
+
+    std::vector<float> spectrum{};
+    pack_kernel(kernel, spectrum);
+    const KernelFileHeader header = make_header(key);
+
+    std::error_code error{};
+    const std::filesystem::path target(path);
+    if (target.has_parent_path())
+        std::filesystem::create_directories(target.parent_path(), error);
+
+    /* Unique per call, a concurrent writer of the same key gets its own temporary */
+    const uint64_t stamp = (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    std::filesystem::path temporary = target;
+    temporary += ".tmp" + std::to_string(stamp ^ ((uint64_t)std::random_device{}() << 32));
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            printf("failed to create kernel cache file %s.\n", temporary.string().c_str());
+            return false;
+        }
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)spectrum.data(), (std::streamsize)header.spectrum_bytes);
+        if (!file)
+        {
+            printf("failed to write kernel cache file %s.\n", temporary.string().c_str());
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    /* Another process may have stored the same kernel in the meantime, either copy is fine */
+    std::filesystem::rename(temporary, target, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return std::filesystem::exists(target, error);
+    }
+    return true;
+}
+
+bool MappedKernel::open(const std::string& path, const KernelCacheKey& key)
+{
+    close();
+    if (!file.open(path.c_str()))
+        return false;
+
+    const KernelFileHeader expected = make_header(key);
+    KernelFileHeader header{};
+    if (file.size() < sizeof(header))
+    {
+        close();
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    /* The hash only names the file, the key itself decides (collisions & stale versions) */
+    const bool matches =
+        std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+        header.file_version == expected.file_version &&
+        header.shader_version == expected.shader_version && header.hash == expected.hash &&
+        header.num_blades == expected.num_blades && header.radius == expected.radius &&
+        header.rotation == expected.rotation && header.size == expected.size &&
+        header.precision == expected.precision &&
+        header.spectrum_width == expected.spectrum_width &&
+        header.spectrum_bytes == expected.spectrum_bytes &&
+        file.size() == sizeof(header) + header.spectrum_bytes;
+    if (!matches)
+    {
+        close();
+        return false;
+    }
+
+    bytes = (size_t)header.spectrum_bytes;
+    return true;
+}
+
+void MappedKernel::close()
+{
+    file.close();
+    bytes = 0;
+}
+
+const float* MappedKernel::spectrum() const
+{
+    return (const float*)(file.data() + sizeof(KernelFileHeader));
+}
+
+} // namespace fft
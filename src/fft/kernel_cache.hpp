@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "convolution.hpp"
+#include "io/mapped_file.hpp"
+
+/*
+ * On-Disk Cache of Finished Kernel Spectra.
+ * The spectrum of build_kernel is real & the same in every channel, so a file holds one real half
+ * spectrum in the packed layout of the renderer's kernel texture (real_spectrum.cs, 4 values per
+ * RGBA32F texel), a mapped file is uploaded as is.
+ */
+namespace fft
+{
+
+/*
+ * Version of the Aperture -> PSF -> Spectrum Chain. Bump it whenever aperture_mask.cs,
+ * compute_psf.cs or their CPU counterparts change, files of other versions are ignored.
+ */
+constexpr uint32_t KERNEL_SHADER_VERSION = 1;
+
+/* Identifies One Kernel Spectrum */
+struct KernelCacheKey
+{
+    ApertureParams params{};
+    uint32_t size = 0; /* Of the (square) transform */
+    Precision precision = Precision::SINGLE;
+    uint32_t shader_version = KERNEL_SHADER_VERSION;
+
+    bool operator==(const KernelCacheKey& other) const = default;
+};
+
+/* 64-Bit FNV-1a Hash of Every Field of the Key */
+uint64_t hash_kernel_key(const KernelCacheKey& key);
+
+/* Path of the Key's File in the Directory, e.g. "cache/kernels/kernel_0123456789abcdef.bin" */
+std::string kernel_cache_path(const std::string& directory, const KernelCacheKey& key);
+
+/*
+ * Converts a Kernel From build_kernel to the Texture Layout: the spectrum transposed
+ * (value k * size + y is frequency k of row y), size x (size / 2 + 1) values.
+ */
+void pack_kernel(const KernelSpectrum& kernel, std::vector<float>& spectrum);
+
+/*
+ * Writes the Kernel to the Path (Creating its Directory). The file is written under a temporary
+ * name and renamed, so processes starting at the same time never map a half written file.
+ */
+bool save_kernel(const std::string& path, const KernelCacheKey& key, const KernelSpectrum& kernel);
+
+/* A Mapped Cache File, Only Valid if it Was Written for the Same Key */
+class MappedKernel
+{
+  public:
+    /* Returns False if the File is Missing, Truncated or Belongs to Another Key (or Version) */
+    bool open(const std::string& path, const KernelCacheKey& key);
+    void close();
+
+    bool is_open() const { return file.is_open(); }
+
+    /* Packed Real Spectrum (as pack_kernel Writes it), spectrum_bytes() Long */
+    const float* spectrum() const;
+    size_t spectrum_bytes() const { return bytes; }
+
+  private:
+    io::MappedFile file{};
+    size_t bytes = 0;
+};
+
+} // namespace fft
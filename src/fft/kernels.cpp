@@ -0,0 +1,132 @@
+#include "kernels.hpp"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FFT_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace fft
+{
+
+#if defined(FFT_X86)
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+    int out[4];
+    __cpuidex(out, (int)leaf, (int)subleaf);
+    for (uint32_t i = 0; i < 4; ++i)
+        regs[i] = (uint32_t)out[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* Reads XCR0, which tells us which register states the OS saves on context switches */
+static uint64_t xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+#endif
+
+Isa detect_isa()
+{
+#if defined(FFT_X86)
+    uint32_t regs[4]{};
+    cpuid(0, 0, regs);
+    const uint32_t max_leaf = regs[0];
+    if (max_leaf < 7)
+        return Isa::SCALAR;
+
+    cpuid(1, 0, regs);
+    const bool fma = (regs[2] >> 12) & 1;
+    const bool osxsave = (regs[2] >> 27) & 1;
+    const bool avx = (regs[2] >> 28) & 1;
+    if (!fma || !osxsave || !avx)
+        return Isa::SCALAR;
+
+    /* The OS has to save the YMM (and for AVX-512 the ZMM & opmask) registers */
+    const uint64_t xcr0 = xgetbv0();
+    const bool ymm_state = (xcr0 & 0x6) == 0x6;
+    const bool zmm_state = (xcr0 & 0xE6) == 0xE6;
+
+    cpuid(7, 0, regs);
+    const bool avx2 = (regs[1] >> 5) & 1;
+    const bool avx512f = (regs[1] >> 16) & 1;
+
+    if (avx2 && avx512f && zmm_state)
+        return Isa::AVX512;
+    if (avx2 && ymm_state)
+        return Isa::AVX2;
+#endif
+    return Isa::SCALAR;
+}
+
+const char* isa_name(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::AVX512:
+        return "avx512";
+    case Isa::AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+static Kernels make_kernels(Isa isa)
+{
+    Kernels kernels{};
+    kernels.isa = isa;
+    switch (isa)
+    {
+    case Isa::AVX512:
+        kernels.transform_rows = avx512::transform_rows;
+        kernels.transpose = avx512::transpose;
+        avx512::get_static_kernels(kernels.static_transform_rows);
+        break;
+    case Isa::AVX2:
+        kernels.transform_rows = avx2::transform_rows;
+        kernels.transpose = avx2::transpose;
+        avx2::get_static_kernels(kernels.static_transform_rows);
+        break;
+    default:
+        kernels.transform_rows = scalar::transform_rows;
+        kernels.transpose = scalar::transpose;
+        scalar::get_static_kernels(kernels.static_transform_rows);
+        break;
+    }
+    return kernels;
+}
+
+static Kernels& active_kernels()
+{
+    static Kernels kernels = make_kernels(detect_isa());
+    return kernels;
+}
+
+const Kernels& get_kernels()
+{
+    return active_kernels();
+}
+
+bool set_isa(Isa isa)
+{
+    if ((uint32_t)isa > (uint32_t)detect_isa())
+        return false;
+
+    active_kernels() = make_kernels(isa);
+    return true;
+}
+
+} // namespace fft
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fft.hpp"
+#include "static_plan.hpp"
+
+/* SIMD Kernels for the CPU FFT & Image Decoding (Selected at Runtime via CPUID) */
+namespace fft
+{
+
+enum class Isa
+{
+    SCALAR,
+    AVX2,
+    AVX512
+};
+
+/*
+ * A Single Radix Pass of a Stockham FFT over Split Real/Imaginary Arrays.
+ * For p < count and q < stride:
+ *   y[q + s * (r * p + k)] = DFT_r(x[q + s * (p + j * count)])[k] * W^(p * k)
+ */
+struct Stage
+{
+    uint32_t radix = 0;  /* 2, 3, 4, 5, 7 or 8 */
+    uint32_t stride = 0; /* Distance between the interleaved sub-sequences (s) */
+    uint32_t count = 0;  /* Butterflies per sub-sequence (m) */
+
+    /* (radix - 1) * count twiddles, laid out as [k - 1][p] (already conjugated for inverse) */
+    const float* twiddle_re = nullptr;
+    const float* twiddle_im = nullptr;
+};
+
+/*
+ * Transforms a batch of rows in place, rows are `row_stride` floats apart.
+ * The scratch buffers have to hold at least `size` floats each.
+ */
+using TransformRowsFn = void (*)(float* re, float* im, size_t row_stride, uint32_t rows,
+                                 uint32_t size, const Stage* stages, uint32_t stage_count,
+                                 Direction direction, float* scratch_re, float* scratch_im);
+
+/* Like TransformRowsFn for One Static Size, Whose Schedule & Twiddles are Baked Into the Kernel */
+using StaticTransformRowsFn = void (*)(float* re, float* im, size_t row_stride, uint32_t rows,
+                                       Direction direction, float* scratch_re, float* scratch_im);
+
+/* dst[x][y] = src[y][x] for a width x height block of floats */
+using TransposeFn = void (*)(const float* src, size_t src_stride, float* dst, size_t dst_stride,
+                             uint32_t width, uint32_t height);
+
+struct Kernels
+{
+    Isa isa = Isa::SCALAR;
+    TransformRowsFn transform_rows = nullptr;
+    TransposeFn transpose = nullptr;
+
+    /* Indexed by static_size_index */
+    StaticTransformRowsFn static_transform_rows[STATIC_SIZE_COUNT]{};
+};
+
+/* Returns the Widest Instruction Set Supported by the CPU & OS */
+Isa detect_isa();
+
+const char* isa_name(Isa isa);
+
+/* Returns the Active Kernels (Detected on First Use) */
+const Kernels& get_kernels();
+
+/* Forces an Instruction Set (e.g. for Benchmarks), Returns False if the CPU Lacks It */
+bool set_isa(Isa isa);
+
+/* Per Instruction Set Entry Points (kernels_*.cpp) */
+namespace scalar
+{
+void transform_rows(float* re, float* im, size_t row_stride, uint32_t rows, uint32_t size,
+                    const Stage* stages, uint32_t stage_count, Direction direction,
+                    float* scratch_re, float* scratch_im);
+void transpose(const float* src, size_t src_stride, float* dst, size_t dst_stride, uint32_t width,
+               uint32_t height);
+void get_static_kernels(StaticTransformRowsFn (&kernels)[STATIC_SIZE_COUNT]);
+}
+namespace avx2
+{
+void transform_rows(float* re, float* im, size_t row_stride, uint32_t rows, uint32_t size,
+                    const Stage* stages, uint32_t stage_count, Direction direction,
+                    float* scratch_re, float* scratch_im);
+void transpose(const float* src, size_t src_stride, float* dst, size_t dst_stride, uint32_t width,
+               uint32_t height);
+void get_static_kernels(StaticTransformRowsFn (&kernels)[STATIC_SIZE_COUNT]);
+}
+namespace avx512
+{
+void transform_rows(float* re, float* im, size_t row_stride, uint32_t rows, uint32_t size,
+                    const Stage* stages, uint32_t stage_count, Direction direction,
+                    float* scratch_re, float* scratch_im);
+void transpose(const float* src, size_t src_stride, float* dst, size_t dst_stride, uint32_t width,
+               uint32_t height);
+void get_static_kernels(StaticTransformRowsFn (&kernels)[STATIC_SIZE_COUNT]);
+}
+
+} // namespace fft
@@ -0,0 +1,40 @@
+/* Compiled with AVX2 & FMA enabled (see CMakeLists.txt), only called if the CPU supports them */
+#include "blocked_transpose.hpp"
+#include "stockham.hpp"
+
+namespace fft::avx2
+{
+
+void transform_rows(float* re, float* im, size_t row_stride, uint32_t rows, uint32_t size,
+                    const Stage* stages, uint32_t stage_count, Direction direction,
+                    float* scratch_re, float* scratch_im)
+{
+#if defined(__AVX2__)
+    fft::transform_rows<Avx2Vec, Avx2Vec>(re, im, row_stride, rows, size, stages, stage_count,
+                                          direction, scratch_re, scratch_im);
+#else
+    fft::transform_rows<ScalarVec, ScalarVec>(re, im, row_stride, rows, size, stages, stage_count,
+                                              direction, scratch_re, scratch_im);
+#endif
+}
+
+void transpose(const float* src, size_t src_stride, float* dst, size_t dst_stride, uint32_t width,
+               uint32_t height)
+{
+#if defined(__AVX2__)
+    fft::blocked_transpose<Avx2Vec>(src, src_stride, dst, dst_stride, width, height);
+#else
+    fft::blocked_transpose<ScalarVec>(src, src_stride, dst, dst_stride, width, height);
+#endif
+}
+
+void get_static_kernels(StaticTransformRowsFn (&kernels)[STATIC_SIZE_COUNT])
+{
+#if defined(__AVX2__)
+    fft::static_kernels<Avx2Vec, Avx2Vec>(kernels);
+#else
+    fft::static_kernels<ScalarVec, ScalarVec>(kernels);
+#endif
+}
+
+} // namespace fft::avx2
@@ -0,0 +1,41 @@
+/* Compiled with AVX-512F, AVX2 & FMA enabled (see CMakeLists.txt), only called if supported */
+#include "blocked_transpose.hpp"
+#include "stockham.hpp"
+
+namespace fft::avx512
+{
+
+void transform_rows(float* re, float* im, size_t row_stride, uint32_t rows, uint32_t size,
+                    const Stage* stages, uint32_t stage_count, Direction direction,
+                    float* scratch_re, float* scratch_im)
+{
+#if defined(__AVX512F__) && defined(__AVX2__)
+    /* Strides below 16 (the first two radix-8 stages) fall back to 256-bit vectors */
+    fft::transform_rows<Avx512Vec, Avx2Vec>(re, im, row_stride, rows, size, stages, stage_count,
+                                            direction, scratch_re, scratch_im);
+#else
+    fft::transform_rows<ScalarVec, ScalarVec>(re, im, row_stride, rows, size, stages, stage_count,
+                                              direction, scratch_re, scratch_im);
+#endif
+}
+
+void transpose(const float* src, size_t src_stride, float* dst, size_t dst_stride, uint32_t width,
+               uint32_t height)
+{
+#if defined(__AVX2__)
+    fft::blocked_transpose<Avx2Vec>(src, src_stride, dst, dst_stride, width, height);
+#else
+    fft::blocked_transpose<ScalarVec>(src, src_stride, dst, dst_stride, width, height);
+#endif
+}
+
+void get_static_kernels(StaticTransformRowsFn (&kernels)[STATIC_SIZE_COUNT])
+{
+#if defined(__AVX512F__) && defined(__AVX2__)
+    fft::static_kernels<Avx512Vec, Avx2Vec>(kernels);
+#else
+    fft::static_kernels<ScalarVec, ScalarVec>(kernels);
+#endif
+}
+
+} // namespace fft::avx512
@@ -0,0 +1,26 @@
+#include "blocked_transpose.hpp"
+#include "stockham.hpp"
+
+namespace fft::scalar
+{
+
+void transform_rows(float* re, float* im, size_t row_stride, uint32_t rows, uint32_t size,
+                    const Stage* stages, uint32_t stage_count, Direction direction,
+                    float* scratch_re, float* scratch_im)
+{
+    fft::transform_rows<ScalarVec, ScalarVec>(re, im, row_stride, rows, size, stages, stage_count,
+                                              direction, scratch_re, scratch_im);
+}
+
+void transpose(const float* src, size_t src_stride, float* dst, size_t dst_stride, uint32_t width,
+               uint32_t height)
+{
+    fft::blocked_transpose<ScalarVec>(src, src_stride, dst, dst_stride, width, height);
+}
+
+void get_static_kernels(StaticTransformRowsFn (&kernels)[STATIC_SIZE_COUNT])
+{
+    fft::static_kernels<ScalarVec, ScalarVec>(kernels);
+}
+
+} // namespace fft::scalar
@@ -0,0 +1,197 @@
+#include "multires.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "thread_pool.hpp"
+
+namespace fft
+{
+
+/* Rows Resampled per Task */
+constexpr size_t RESAMPLE_ROW_GRAIN = 16;
+
+ApertureParams scale_aperture(const ApertureParams& params, uint32_t scale)
+{
+    ApertureParams scaled = params;
+    scaled.radius = std::min(params.radius * (float)scale, 0.5f);
+    return scaled;
+}
+
+GlowParams scale_glow(const GlowParams& glow, uint32_t scale)
+{
+    GlowParams scaled = glow;
+    scaled.sigma = glow.sigma / (float)scale;
+    return scaled;
+}
+
+void downsample(const ImageView& input, uint32_t scale, ImageRGBA& output)
+{
+    output.resize((input.width + scale - 1) / scale, (input.height + scale - 1) / scale);
+
+    const uint32_t height = output.height;
+    get_thread_pool().parallel_for(height, RESAMPLE_ROW_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+        {
+            /* Blocks past the edge of the image only average the pixels inside it */
+            const uint32_t y0 = (uint32_t)y * scale;
+            const uint32_t y1 = std::min(y0 + scale, input.height);
+            for (uint32_t x = 0; x < output.width; ++x)
+            {
+                const uint32_t x0 = x * scale;
+                const uint32_t x1 = std::min(x0 + scale, input.width);
+
+                float sum[4] = {};
+                for (uint32_t sy = y0; sy < y1; ++sy)
+                {
+                    const float* src = input.pixels + ((size_t)sy * input.width + x0) * 4;
+                    for (uint32_t sx = x0; sx < x1; ++sx, src += 4)
+                        for (uint32_t c = 0; c < 4; ++c)
+                            sum[c] += src[c];
+                }
+
+                const float norm = 1.0f / (float)((y1 - y0) * (x1 - x0));
+                float* dst = &output.pixels[((size_t)y * output.width + x) * 4];
+                for (uint32_t c = 0; c < 4; ++c)
+                    dst[c] = sum[c] * norm;
+            }
+        }
+    });
+}
+
+/* Catmull-Rom Taps for the Four Samples Around a Fractional Position t (0-1) */
+static void catmull_rom_weights(float t, float weights[4])
+{
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    weights[0] = 0.5f * (-t3 + 2.0f * t2 - t);
+    weights[1] = 0.5f * (3.0f * t3 - 5.0f * t2 + 2.0f);
+    weights[2] = 0.5f * (-3.0f * t3 + 4.0f * t2 + t);
+    weights[3] = 0.5f * (t3 - t2);
+}
+
+/* Taps of One Output Coordinate: the First Source Index (Before Clamping) & its 4 Weights */
+struct ResampleTaps
+{
+    int32_t first = 0;
+    float weights[4]{};
+};
+
+static std::vector<ResampleTaps> resample_taps(uint32_t size, uint32_t scale)
+{
+    /* Pixel centers line up with the centers of the blocks downsample averaged */
+    std::vector<ResampleTaps> taps(size);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        const float position = ((float)i + 0.5f) / (float)scale - 0.5f;
+        const float base = std::floor(position);
+        taps[i].first = (int32_t)base - 1;
+        catmull_rom_weights(position - base, taps[i].weights);
+    }
+    return taps;
+}
+
+void upsample(const ImageView& input, uint32_t scale, uint32_t width, uint32_t height,
+              ImageRGBA& output)
+{
+    output.resize(width, height);
+    const std::vector<ResampleTaps> taps_x = resample_taps(width, scale);
+    const std::vector<ResampleTaps> taps_y = resample_taps(height, scale);
+
+    /* Horizontal pass over the level's rows first, so the vertical one reads 4 finished rows */
+    std::vector<float> rows((size_t)width * input.height * 4);
+    get_thread_pool().parallel_for(input.height, RESAMPLE_ROW_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+        {
+            const float* src = input.pixels + y * input.width * 4;
+            float* dst = &rows[y * width * 4];
+            for (uint32_t x = 0; x < width; ++x, dst += 4)
+            {
+                const ResampleTaps& tap = taps_x[x];
+                for (uint32_t c = 0; c < 4; ++c)
+                    dst[c] = 0.0f;
+                for (int32_t i = 0; i < 4; ++i)
+                {
+                    const int32_t sx = std::clamp(tap.first + i, 0, (int32_t)input.width - 1);
+                    for (uint32_t c = 0; c < 4; ++c)
+                        dst[c] += tap.weights[i] * src[(size_t)sx * 4 + c];
+                }
+            }
+        }
+    });
+
+    get_thread_pool().parallel_for(height, RESAMPLE_ROW_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y)
+        {
+            const ResampleTaps& tap = taps_y[y];
+            const float* src[4];
+            for (int32_t i = 0; i < 4; ++i)
+            {
+                const int32_t sy = std::clamp(tap.first + i, 0, (int32_t)input.height - 1);
+                src[i] = &rows[(size_t)sy * width * 4];
+            }
+
+            float* dst = &output.pixels[y * width * 4];
+            for (size_t i = 0; i < (size_t)width * 4; ++i)
+            {
+                const float value = tap.weights[0] * src[0][i] + tap.weights[1] * src[1][i] +
+                                    tap.weights[2] * src[2][i] + tap.weights[3] * src[3][i];
+                dst[i] = std::max(value, 0.0f);
+            }
+        }
+    });
+}
+
+bool convolve_downsampled(const ImageView& input, uint32_t scale, const KernelSpectrum& kernel,
+                          ImageRGBA& output)
+{
+    if (scale <= 1)
+        return convolve(input, kernel, output);
+
+    ImageRGBA level{};
+    downsample(input, scale, level);
+
+    ImageRGBA convolved{};
+    if (!convolve(level, kernel, convolved))
+        return false;
+
+    upsample(convolved, scale, input.width, input.height, output);
+    return true;
+}
+
+ImageError compare_images(const ImageView& reference, const ImageView& image)
+{
+    ImageError error{};
+    if (reference.width != image.width || reference.height != image.height)
+    {
+        printf("cannot compare a %ux%u image to a %ux%u reference.\n", image.width, image.height,
+               reference.width, reference.height);
+        error.max_abs = error.rmse = error.relative_rmse = INFINITY;
+        return error;
+    }
+
+    double squared = 0.0, reference_squared = 0.0, peak = 0.0;
+    const size_t count = (size_t)reference.width * reference.height;
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            const double expected = reference.pixels[i * 4 + c];
+            const double difference = (double)image.pixels[i * 4 + c] - expected;
+            error.max_abs = std::max(error.max_abs, std::abs(difference));
+            squared += difference * difference;
+            reference_squared += expected * expected;
+            peak = std::max(peak, expected);
+        }
+    }
+
+    const double samples = (double)count * 3.0;
+    error.rmse = std::sqrt(squared / samples);
+    const double reference_rms = std::sqrt(reference_squared / samples);
+    error.relative_rmse = reference_rms > 0.0 ? error.rmse / reference_rms : 0.0;
+    error.psnr = error.rmse > 0.0 ? 20.0 * std::log10(peak / error.rmse) : INFINITY;
+    return error;
+}
+
+} // namespace fft
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "convolution.hpp"
+
+/*
+ * Multi-Resolution Bloom: Convolving a Downsampled Level & Upsampling the Result.
+ * Wide PSFs are mostly low frequency, so at 1/2 (1/4) resolution the transforms do roughly 4x (16x)
+ * less work for a small, measurable loss (see compare_images).
+ */
+namespace fft
+{
+
+/*
+ * Aperture of the Kernel for a Level Downsampled by `scale`. The PSF of an aperture spans about
+ * 1 / radius pixels whatever the transform size, so the radius grows with the scale to keep the
+ * bloom the same size at full resolution (it is clamped to the 0.5 the mask can hold).
+ */
+ApertureParams scale_aperture(const ApertureParams& params, uint32_t scale);
+
+/* Glow of the Kernel for a Level Downsampled by `scale` (sigma is in pixels, so it shrinks) */
+GlowParams scale_glow(const GlowParams& glow, uint32_t scale);
+
+/* Box Filters scale x scale Blocks, the Output is ceil(width / scale) x ceil(height / scale) */
+void downsample(const ImageView& input, uint32_t scale, ImageRGBA& output);
+
+/*
+ * Upsamples a Level Made by downsample(scale) Back to width x height With a Separable Catmull-Rom
+ * Filter (Sharper Than Bilinear, Without its Blocky Diagonals). Ringing below zero is clamped.
+ */
+void upsample(const ImageView& input, uint32_t scale, uint32_t width, uint32_t height,
+              ImageRGBA& output);
+
+/*
+ * Convolves the Input at 1 / scale Resolution: downsample -> convolve -> upsample. The kernel comes
+ * from build_kernel with scale_aperture(params, scale) & the level's size (kernel_size / scale).
+ */
+bool convolve_downsampled(const ImageView& input, uint32_t scale, const KernelSpectrum& kernel,
+                          ImageRGBA& output);
+
+/* Error of an Image Against a Reference of the Same Size (RGB Channels Only) */
+struct ImageError
+{
+    double max_abs = 0.0;       /* Largest absolute difference */
+    double rmse = 0.0;          /* Root mean square difference */
+    double relative_rmse = 0.0; /* rmse / root mean square of the reference */
+    double psnr = 0.0;          /* dB, relative to the brightest reference channel */
+};
+
+ImageError compare_images(const ImageView& reference, const ImageView& image);
+
+} // namespace fft
@@ -0,0 +1,235 @@
+#include "psf_bank.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include "kernel_cache.hpp"
+
+namespace fft
+{
+
+/* Bump When the Layout Below Changes */
+constexpr uint32_t BANK_FILE_VERSION = 1;
+constexpr char BANK_FILE_MAGIC[8] = {'L', 'U', 'C', 'E', 'O', 'P', 'S', 'B'};
+
+/* File Header, Padded to 64 Bytes so the Nodes Start Cache Line Aligned */
+struct BankFileHeader
+{
+    char magic[8]{};
+    uint32_t file_version = 0;
+    uint32_t shader_version = 0;
+
+    uint32_t num_blades = 0;
+    uint32_t size = 0;
+    uint32_t radii = 0;
+    uint32_t rotations = 0;
+    float min_radius = 0.0f;
+    float max_radius = 0.0f;
+
+    uint64_t node_bytes = 0; /* radii * rotations nodes follow the header */
+    uint8_t padding[16]{};
+};
+static_assert(sizeof(BankFileHeader) == 64, "the nodes should start at 64 bytes");
+
+static BankFileHeader make_header(const PsfBankGrid& grid, uint32_t num_blades, uint32_t size)
+{
+    BankFileHeader header{};
+    std::memcpy(header.magic, BANK_FILE_MAGIC, sizeof(header.magic));
+    header.file_version = BANK_FILE_VERSION;
+    header.shader_version = KERNEL_SHADER_VERSION;
+    header.num_blades = num_blades;
+    header.size = size;
+    header.radii = grid.radii;
+    header.rotations = grid.rotations;
+    header.min_radius = grid.min_radius;
+    header.max_radius = grid.max_radius;
+    header.node_bytes = (uint64_t)size * (size / 2 + 1) * sizeof(float);
+    return header;
+}
+
+float rotation_period(uint32_t num_blades)
+{
+    const float period = 6.28318530718f / (float)num_blades;
+    return num_blades % 2 ? period * 0.5f : period;
+}
+
+ApertureParams psf_bank_node(const PsfBankGrid& grid, uint32_t num_blades, uint32_t node)
+{
+    const uint32_t radius_index = node / grid.rotations;
+    const uint32_t rotation_index = node % grid.rotations;
+    const float t = grid.radii > 1 ? (float)radius_index / (float)(grid.radii - 1) : 0.0f;
+
+    ApertureParams params{};
+    params.num_blades = num_blades;
+    params.radius = grid.min_radius * std::pow(grid.max_radius / grid.min_radius, t);
+    params.rotation = rotation_period(num_blades) * (float)rotation_index / (float)grid.rotations;
+    return params;
+}
+
+std::array<PsfBankSample, 4> psf_bank_samples(const PsfBankGrid& grid,
+                                              const ApertureParams& params)
+{
+    /* Radius: position on the geometric axis, clamped to its ends */
+    const float radius = std::clamp(params.radius, grid.min_radius, grid.max_radius);
+    const float u = grid.radii > 1 ? std::log(radius / grid.min_radius) /
+                                         std::log(grid.max_radius / grid.min_radius) *
+                                         (float)(grid.radii - 1)
+                                   : 0.0f;
+    const uint32_t r0 = std::min((uint32_t)u, grid.radii > 1 ? grid.radii - 2 : 0u);
+    const uint32_t r1 = std::min(r0 + 1, grid.radii - 1);
+    const float fr = std::clamp(u - (float)r0, 0.0f, 1.0f);
+
+    /* Rotation: wraps around the period, the last node blends with the first */
+    const float period = rotation_period(params.num_blades);
+    float rotation = std::fmod(params.rotation, period);
+    if (rotation < 0.0f)
+        rotation += period;
+    const float v = rotation / period * (float)grid.rotations;
+    const uint32_t a0 = std::min((uint32_t)v, grid.rotations - 1);
+    const uint32_t a1 = (a0 + 1) % grid.rotations;
+    const float fa = std::clamp(v - (float)a0, 0.0f, 1.0f);
+
+    return {{{r0 * grid.rotations + a0, (1.0f - fr) * (1.0f - fa)},
+             {r0 * grid.rotations + a1, (1.0f - fr) * fa},
+             {r1 * grid.rotations + a0, fr * (1.0f - fa)},
+             {r1 * grid.rotations + a1, fr * fa}}};
+}
+
+std::string psf_bank_path(const std::string& directory, uint32_t num_blades, uint32_t size)
+{
+    char name[48];
+    snprintf(name, sizeof(name), "psf_bank_%u_%u.bin", num_blades, size);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool build_psf_bank(const std::string& path, const PsfBankGrid& grid, uint32_t num_blades,
+                    uint32_t size, const std::atomic<bool>* cancel)
+{
+    if (grid.radii == 0 || grid.rotations == 0 || num_blades < 3)
+        return false;
+
+    const BankFileHeader header = make_header(grid, num_blades, size);
+
+    std::error_code error{};
+    const std::filesystem::path target(path);
+    if (target.has_parent_path())
+        std::filesystem::create_directories(target.parent_path(), error);
+
+    /* Same scheme as save_kernel, a concurrent builder gets its own temporary */
+    const uint64_t stamp = (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+    std::filesystem::path temporary = target;
+    temporary += ".tmp" + std::to_string(stamp ^ ((uint64_t)std::random_device{}() << 32));
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            printf("failed to create psf bank file %s.\n", temporary.string().c_str());
+            return false;
+        }
+        file.write((const char*)&header, sizeof(header));
+
+        /* Only one node is held at a time, a bank of 1024² kernels is a few hundred MB */
+        KernelSpectrum kernel{};
+        std::vector<float> packed{};
+        for (uint32_t node = 0; node < grid.radii * grid.rotations && file; ++node)
+        {
+            if (cancel && cancel->load())
+            {
+                file.close();
+                std::filesystem::remove(temporary, error);
+                return false;
+            }
+
+            /* Packed like a cached kernel, the spectrum is real (the aperture's autocorrelation) */
+            build_kernel(psf_bank_node(grid, num_blades, node), size, kernel);
+            pack_kernel(kernel, packed);
+            file.write((const char*)packed.data(), (std::streamsize)header.node_bytes);
+        }
+
+        if (!file)
+        {
+            printf("failed to write psf bank file %s.\n", temporary.string().c_str());
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary, target, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return std::filesystem::exists(target, error);
+    }
+    return true;
+}
+
+bool PsfBank::open(const std::string& path, const PsfBankGrid& new_grid, uint32_t num_blades,
+                   uint32_t size)
+{
+    close();
+    if (!file.open(path.c_str()))
+        return false;
+
+    const BankFileHeader expected = make_header(new_grid, num_blades, size);
+    BankFileHeader header{};
+    if (file.size() < sizeof(header))
+    {
+        close();
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    const uint64_t nodes = (uint64_t)new_grid.radii * new_grid.rotations;
+    const bool matches =
+        std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+        header.file_version == expected.file_version &&
+        header.shader_version == expected.shader_version &&
+        header.num_blades == expected.num_blades && header.size == expected.size &&
+        header.radii == expected.radii && header.rotations == expected.rotations &&
+        header.min_radius == expected.min_radius && header.max_radius == expected.max_radius &&
+        header.node_bytes == expected.node_bytes &&
+        file.size() == sizeof(header) + nodes * header.node_bytes;
+    if (!matches)
+    {
+        close();
+        return false;
+    }
+
+    grid = new_grid;
+    values_per_node = (size_t)header.node_bytes / sizeof(float);
+    return true;
+}
+
+void PsfBank::close()
+{
+    file.close();
+    values_per_node = 0;
+}
+
+const float* PsfBank::node(uint32_t index) const
+{
+    return (const float*)(file.data() + sizeof(BankFileHeader)) + (size_t)index * values_per_node;
+}
+
+void PsfBank::blend(const ApertureParams& params, std::vector<float>& output) const
+{
+    const std::array<PsfBankSample, 4> samples = psf_bank_samples(grid, params);
+    const float* nodes[4] = {node(samples[0].node), node(samples[1].node), node(samples[2].node),
+                             node(samples[3].node)};
+
+    /* A single pass over the mapped nodes, cheap enough for every slider tick */
+    output.resize(values_per_node);
+    for (size_t i = 0; i < values_per_node; ++i)
+        output[i] = samples[0].weight * nodes[0][i] + samples[1].weight * nodes[1][i] +
+                    samples[2].weight * nodes[2][i] + samples[3].weight * nodes[3][i];
+}
+
+} // namespace fft
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "convolution.hpp"
+#include "io/mapped_file.hpp"
+
+/*
+ * PSF Bank: Kernel Spectra Precomputed Over a Grid of Apertures.
+ * While the aperture sliders move, the kernel is blended from the nearest grid nodes instead of
+ * being rebuilt, the exact kernel is only built once they settle. A bank file covers one blade
+ * count (a discrete slider) & transform size. Radii are spaced geometrically, as the PSF scales
+ * with 1 / radius, rotations evenly over the symmetry period of the kernel. Each node holds the
+ * real kernel spectrum in the packed layout of the renderer's kernel texture (real_spectrum.cs).
+ */
+namespace fft
+{
+
+/* Nodes of a Bank, radii x rotations per Blade Count */
+struct PsfBankGrid
+{
+    uint32_t radii = 24;
+    uint32_t rotations = 8;
+    float min_radius = 0.01f;
+    float max_radius = 0.5f;
+
+    bool operator==(const PsfBankGrid& other) const = default;
+};
+
+/* A Grid Node & its Weight in a Blend */
+struct PsfBankSample
+{
+    uint32_t node = 0;
+    float weight = 0.0f;
+};
+
+/*
+ * Rotation After Which the Kernel Repeats: 2π / blades, Halved for Odd Blade Counts (the PSF is
+ * centrosymmetric, so a pentagon's looks the same after π / 5)
+ */
+float rotation_period(uint32_t num_blades);
+
+/* Aperture of a Node (Nodes are Numbered radius_index * rotations + rotation_index) */
+ApertureParams psf_bank_node(const PsfBankGrid& grid, uint32_t num_blades, uint32_t node);
+
+/* The 4 Nodes Around the Aperture & Their Bilinear Weights (in log(radius) & rotation) */
+std::array<PsfBankSample, 4> psf_bank_samples(const PsfBankGrid& grid,
+                                              const ApertureParams& params);
+
+/* Path of the Bank of a Blade Count & Size, e.g. "cache/kernels/psf_bank_6_512.bin" */
+std::string psf_bank_path(const std::string& directory, uint32_t num_blades, uint32_t size);
+
+/*
+ * Builds Every Node With build_kernel & Writes the Bank to the Path, Node by Node (Under a
+ * Temporary Name, Renamed Once Complete). Returns False on failure or once `cancel` is set.
+ */
+bool build_psf_bank(const std::string& path, const PsfBankGrid& grid, uint32_t num_blades,
+                    uint32_t size, const std::atomic<bool>* cancel = nullptr);
+
+/* A Mapped Bank File, Only Valid if it Was Written for the Same Grid, Blade Count & Size */
+class PsfBank
+{
+  public:
+    /* Returns False if the File is Missing, Truncated or Was Built for Other Parameters */
+    bool open(const std::string& path, const PsfBankGrid& grid, uint32_t num_blades,
+              uint32_t size);
+    void close();
+
+    bool is_open() const { return file.is_open(); }
+
+    /* Real Values of a Node, size x (size / 2 + 1) */
+    const float* node(uint32_t index) const;
+    size_t node_values() const { return values_per_node; }
+
+    /* Blends the Kernel Spectrum of the Aperture (Same Blade Count) From its 4 Nearest Nodes */
+    void blend(const ApertureParams& params, std::vector<float>& output) const;
+
+  private:
+    io::MappedFile file{};
+    PsfBankGrid grid{};
+    size_t values_per_node = 0;
+};
+
+} // namespace fft
@@ -0,0 +1,101 @@
+#pragma once
+
+/*
+ * SIMD Vector Types Shared by the Kernel Templates (stockham.hpp, transpose kernels).
+ * Like the templates, they live in an anonymous namespace and are only included by the
+ * kernels_*.cpp & io/rgbe_*.cpp files, which are each compiled for a different instruction set.
+ */
+
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace fft
+{
+namespace
+{
+
+struct ScalarVec
+{
+    using T = float;
+    static constexpr uint32_t WIDTH = 1;
+
+    static T load(const float* ptr) { return *ptr; }
+    static void store(float* ptr, T v) { *ptr = v; }
+    static T set1(float v) { return v; }
+    static T add(T a, T b) { return a + b; }
+    static T sub(T a, T b) { return a - b; }
+    static T mul(T a, T b) { return a * b; }
+    static T fmadd(T a, T b, T c) { return a * b + c; }
+    static T fmsub(T a, T b, T c) { return a * b - c; }
+};
+
+#if defined(__AVX2__)
+struct Avx2Vec
+{
+    using T = __m256;
+    static constexpr uint32_t WIDTH = 8;
+
+    static T load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+    static void store(float* ptr, T v) { _mm256_storeu_ps(ptr, v); }
+    static T set1(float v) { return _mm256_set1_ps(v); }
+    static T add(T a, T b) { return _mm256_add_ps(a, b); }
+    static T sub(T a, T b) { return _mm256_sub_ps(a, b); }
+    static T mul(T a, T b) { return _mm256_mul_ps(a, b); }
+    static T fmadd(T a, T b, T c) { return _mm256_fmadd_ps(a, b, c); }
+    static T fmsub(T a, T b, T c) { return _mm256_fmsub_ps(a, b, c); }
+
+    /* In-Register 8x8 Transpose (v[i][j] -> v[j][i]) */
+    static void transpose8(T (&v)[8])
+    {
+        const T t0 = _mm256_unpacklo_ps(v[0], v[1]);
+        const T t1 = _mm256_unpackhi_ps(v[0], v[1]);
+        const T t2 = _mm256_unpacklo_ps(v[2], v[3]);
+        const T t3 = _mm256_unpackhi_ps(v[2], v[3]);
+        const T t4 = _mm256_unpacklo_ps(v[4], v[5]);
+        const T t5 = _mm256_unpackhi_ps(v[4], v[5]);
+        const T t6 = _mm256_unpacklo_ps(v[6], v[7]);
+        const T t7 = _mm256_unpackhi_ps(v[6], v[7]);
+
+        const T u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        const T u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        const T u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        const T u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        const T u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        const T u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        const T u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        const T u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        v[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+        v[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+        v[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+        v[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+        v[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+        v[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+        v[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+        v[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+    }
+};
+#endif
+
+#if defined(__AVX512F__)
+struct Avx512Vec
+{
+    using T = __m512;
+    static constexpr uint32_t WIDTH = 16;
+
+    static T load(const float* ptr) { return _mm512_loadu_ps(ptr); }
+    static void store(float* ptr, T v) { _mm512_storeu_ps(ptr, v); }
+    static T set1(float v) { return _mm512_set1_ps(v); }
+    static T add(T a, T b) { return _mm512_add_ps(a, b); }
+    static T sub(T a, T b) { return _mm512_sub_ps(a, b); }
+    static T mul(T a, T b) { return _mm512_mul_ps(a, b); }
+    static T fmadd(T a, T b, T c) { return _mm512_fmadd_ps(a, b, c); }
+    static T fmsub(T a, T b, T c) { return _mm512_fmsub_ps(a, b, c); }
+};
+#endif
+
+} // namespace
+} // namespace fft
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "fft.hpp"
+
+/*
+ * Compile-Time Specialised Transforms for the Standard Power-of-Two Sizes (256 - 4096).
+ * The stage list & twiddle tables are constexpr, so the kernels (stockham.hpp) run every stage with
+ * constant strides & counts instead of reading them from a runtime Schedule.
+ */
+namespace fft
+{
+
+constexpr uint32_t STATIC_MIN_SIZE = 256;
+constexpr uint32_t STATIC_MAX_SIZE = 4096;
+constexpr uint32_t STATIC_SIZE_COUNT = 5;
+
+/* Returns True if There is a Specialised Kernel for the Size */
+constexpr bool is_static_size(uint32_t size)
+{
+    return size >= STATIC_MIN_SIZE && size <= STATIC_MAX_SIZE && (size & (size - 1)) == 0;
+}
+
+/* Index of a Static Size in the Kernel Tables (256 -> 0, 4096 -> 4) */
+constexpr uint32_t static_size_index(uint32_t size)
+{
+    uint32_t index = 0;
+    while ((STATIC_MIN_SIZE << index) < size)
+        ++index;
+    return index;
+}
+
+namespace detail
+{
+
+/* Taylor Series, Accurate to Double Precision for |x| <= π/4 */
+constexpr double taylor_sin(double x)
+{
+    double term = x, sum = x;
+    for (int n = 1; n < 12; ++n)
+    {
+        term *= -x * x / (double)((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double taylor_cos(double x)
+{
+    double term = 1.0, sum = 1.0;
+    for (int n = 1; n < 12; ++n)
+    {
+        term *= -x * x / (double)((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+/* cos & sin of 2πj/n (n a Power of Two >= 4), Folded Into the First Octant by Symmetry */
+constexpr void root_of_unity(uint64_t j, uint64_t n, double& c, double& s)
+{
+    const double two_pi = 6.283185307179586;
+    const uint64_t quarter = n / 4;
+    j %= n;
+    const uint64_t quadrant = j / quarter;
+    const uint64_t r = j % quarter;
+
+    double c0 = 0.0, s0 = 0.0;
+    if (2 * r <= quarter)
+    {
+        const double x = two_pi * (double)r / (double)n;
+        c0 = taylor_cos(x);
+        s0 = taylor_sin(x);
+    }
+    else
+    {
+        const double x = two_pi * (double)(quarter - r) / (double)n;
+        c0 = taylor_sin(x);
+        s0 = taylor_cos(x);
+    }
+
+    switch (quadrant)
+    {
+    case 0:
+        c = c0, s = s0;
+        break;
+    case 1:
+        c = -s0, s = c0;
+        break;
+    case 2:
+        c = -c0, s = -s0;
+        break;
+    default:
+        c = s0, s = -c0;
+        break;
+    }
+}
+
+} // namespace detail
+
+/* Stage List of a Static Size, Same Split as the Runtime Schedule (Radix-8s, then 4 or 2) */
+template <uint32_t Size>
+struct StaticSchedule
+{
+    static_assert(is_static_size(Size), "no specialised kernel for this size");
+
+    static constexpr uint32_t LOG_SIZE = 8 + static_size_index(Size);
+    static constexpr uint32_t STAGE_COUNT = LOG_SIZE / 3 + (LOG_SIZE % 3 == 0 ? 0 : 1);
+
+    struct Stages
+    {
+        uint32_t radix[STAGE_COUNT]{};
+        uint32_t stride[STAGE_COUNT]{};
+        uint32_t offset[STAGE_COUNT]{}; /* Of the stage's twiddles in the table */
+        uint32_t twiddle_count = 0;
+    };
+
+    static constexpr Stages make_stages()
+    {
+        Stages stages{};
+        uint32_t count = 0;
+        for (uint32_t i = 0; i + 3 <= LOG_SIZE; i += 3)
+            stages.radix[count++] = 8;
+        if (LOG_SIZE % 3 == 1)
+        {
+            stages.radix[count - 1] = 4;
+            stages.radix[count++] = 4;
+        }
+        else if (LOG_SIZE % 3 == 2)
+            stages.radix[count++] = 4;
+
+        uint32_t stride = 1;
+        for (uint32_t i = 0; i < STAGE_COUNT; ++i)
+        {
+            stages.stride[i] = stride;
+            stages.offset[i] = stages.twiddle_count;
+            stages.twiddle_count += (stages.radix[i] - 1) * (Size / stride / stages.radix[i]);
+            stride *= stages.radix[i];
+        }
+        return stages;
+    }
+
+    static constexpr Stages STAGES = make_stages();
+};
+
+/* Twiddles of All Stages, Laid Out Like the Runtime Schedule (Conjugated for Inverse) */
+template <uint32_t Size, bool Inverse>
+struct StaticTwiddles
+{
+    using Schedule = StaticSchedule<Size>;
+
+    alignas(64) float re[Schedule::STAGES.twiddle_count]{};
+    alignas(64) float im[Schedule::STAGES.twiddle_count]{};
+
+    constexpr StaticTwiddles()
+    {
+        constexpr auto stages = Schedule::STAGES;
+        for (uint32_t i = 0; i < Schedule::STAGE_COUNT; ++i)
+        {
+            const uint32_t radix = stages.radix[i];
+            const uint32_t stride = stages.stride[i];
+            const uint32_t count = Size / stride / radix;
+
+            /* W_L^(p * k) with L = radix * count is W_Size^(p * k * stride) */
+            for (uint32_t k = 1; k < radix; ++k)
+            {
+                for (uint32_t p = 0; p < count; ++p)
+                {
+                    double c = 0.0, s = 0.0;
+                    detail::root_of_unity((uint64_t)p * k * stride, Size, c, s);
+                    const uint32_t index = stages.offset[i] + (k - 1) * count + p;
+                    re[index] = (float)c;
+                    im[index] = Inverse ? (float)s : (float)-s;
+                }
+            }
+        }
+    }
+};
+
+/* Shared by Every Kernel Translation Unit */
+template <uint32_t Size, bool Inverse>
+inline constexpr StaticTwiddles<Size, Inverse> STATIC_TWIDDLES{};
+
+/*
+ * Transforms `rows` Rows of a Static Size in Place (Rows are `row_stride` Floats Apart), Using the
+ * Specialised Kernel of the Active Instruction Set. Same scaling as the runtime transforms.
+ */
+void static_transform_rows(uint32_t size, float* re, float* im, size_t row_stride, uint32_t rows,
+                           Direction direction);
+
+/*
+ * Compile-Time Plan, e.g. fft::StaticPlan<512, float>.
+ * Nothing is looked up or built at runtime: the runtime plans also pick these kernels for static
+ * sizes, this is the direct way in for code that knows its size up front.
+ */
+template <uint32_t Size, typename T = float>
+struct StaticPlan
+{
+    static_assert(is_static_size(Size), "StaticPlan sizes are the powers of two from 256 to 4096");
+    static_assert(std::is_same_v<T, float>, "only single precision kernels exist");
+
+    static constexpr uint32_t SIZE = Size;
+
+    /* Transforms `rows` Rows in Place */
+    static void transform_rows(T* re, T* im, size_t row_stride, uint32_t rows, Direction direction)
+    {
+        static_transform_rows(Size, re, im, row_stride, rows, direction);
+    }
+};
+
+} // namespace fft
@@ -0,0 +1,514 @@
+#pragma once
+
+/*
+ * Stockham Radix-2/3/4/5/7/8 Butterflies over Split Real/Imaginary Arrays, Templated on SIMD Types
+ * (and for the static sizes, on the schedule too).
+ * Only included by the kernels_*.cpp files, each of which is compiled for a different instruction
+ * set. Everything lives in an anonymous namespace, so the linker can never merge an AVX
+ * instantiation into the scalar fallback (or the other way around).
+ */
+
+#include <type_traits>
+#include <utility>
+
+#include "kernels.hpp"
+#include "simd.hpp"
+#include "static_plan.hpp"
+
+namespace fft
+{
+namespace
+{
+
+/* (re, im) *= (wr, wi) */
+template <typename V>
+inline void cmul(typename V::T& re, typename V::T& im, typename V::T wr, typename V::T wi)
+{
+    const typename V::T r = V::fmsub(re, wr, V::mul(im, wi));
+    im = V::fmadd(re, wi, V::mul(im, wr));
+    re = r;
+}
+
+/* 2-Point DFT, a[0..1] -> x[0..1] */
+template <typename V, bool Inverse>
+inline void dft2(const typename V::T* ar, const typename V::T* ai, typename V::T* xr,
+                 typename V::T* xi)
+{
+    xr[0] = V::add(ar[0], ar[1]);
+    xi[0] = V::add(ai[0], ai[1]);
+    xr[1] = V::sub(ar[0], ar[1]);
+    xi[1] = V::sub(ai[0], ai[1]);
+}
+
+/* 4-Point DFT, a[0..3] -> x[0], x[step], x[2 * step], x[3 * step] */
+template <typename V, bool Inverse>
+inline void dft4(const typename V::T* ar, const typename V::T* ai, typename V::T* xr,
+                 typename V::T* xi, uint32_t step = 1)
+{
+    using T = typename V::T;
+    const T t0r = V::add(ar[0], ar[2]), t0i = V::add(ai[0], ai[2]);
+    const T t1r = V::sub(ar[0], ar[2]), t1i = V::sub(ai[0], ai[2]);
+    const T t2r = V::add(ar[1], ar[3]), t2i = V::add(ai[1], ai[3]);
+    const T t3r = V::sub(ar[1], ar[3]), t3i = V::sub(ai[1], ai[3]);
+
+    xr[0] = V::add(t0r, t2r);
+    xi[0] = V::add(t0i, t2i);
+    xr[2 * step] = V::sub(t0r, t2r);
+    xi[2 * step] = V::sub(t0i, t2i);
+
+    /* x1 = t1 -/+ j * t3, x3 = t1 +/- j * t3 */
+    if constexpr (Inverse)
+    {
+        xr[step] = V::sub(t1r, t3i);
+        xi[step] = V::add(t1i, t3r);
+        xr[3 * step] = V::add(t1r, t3i);
+        xi[3 * step] = V::sub(t1i, t3r);
+    }
+    else
+    {
+        xr[step] = V::add(t1r, t3i);
+        xi[step] = V::sub(t1i, t3r);
+        xr[3 * step] = V::sub(t1r, t3i);
+        xi[3 * step] = V::add(t1i, t3r);
+    }
+}
+
+/* 8-Point DFT as Two 4-Point DFTs (Even & Odd Outputs), a[0..7] -> x[0..7] */
+template <typename V, bool Inverse>
+inline void dft8(const typename V::T* ar, const typename V::T* ai, typename V::T* xr,
+                 typename V::T* xi)
+{
+    using T = typename V::T;
+    const T h = V::set1(0.70710678118654752f);
+
+    T cr[4], ci[4], br[4], bi[4];
+    for (uint32_t k = 0; k < 4; ++k)
+    {
+        cr[k] = V::add(ar[k], ar[k + 4]);
+        ci[k] = V::add(ai[k], ai[k + 4]);
+        br[k] = V::sub(ar[k], ar[k + 4]);
+        bi[k] = V::sub(ai[k], ai[k + 4]);
+    }
+
+    /* b[k] *= W8^k */
+    const T b1r = br[1], b1i = bi[1], b2r = br[2], b3r = br[3], b3i = bi[3];
+    if constexpr (Inverse)
+    {
+        br[1] = V::mul(V::sub(b1r, b1i), h);
+        bi[1] = V::mul(V::add(b1r, b1i), h);
+        br[2] = V::sub(V::set1(0.0f), bi[2]);
+        bi[2] = b2r;
+        br[3] = V::mul(V::sub(V::set1(0.0f), V::add(b3r, b3i)), h);
+        bi[3] = V::mul(V::sub(b3r, b3i), h);
+    }
+    else
+    {
+        br[1] = V::mul(V::add(b1r, b1i), h);
+        bi[1] = V::mul(V::sub(b1i, b1r), h);
+        br[2] = bi[2];
+        bi[2] = V::sub(V::set1(0.0f), b2r);
+        br[3] = V::mul(V::sub(b3i, b3r), h);
+        bi[3] = V::mul(V::sub(V::set1(0.0f), V::add(b3r, b3i)), h);
+    }
+
+    dft4<V, Inverse>(cr, ci, xr, xi, 2);
+    dft4<V, Inverse>(br, bi, xr + 1, xi + 1, 2);
+}
+
+/* cos(2πm/R) & sin(2πm/R) for the odd radices, m = 1 .. (R - 1) / 2 */
+template <uint32_t R>
+struct OddRoots;
+
+template <>
+struct OddRoots<3>
+{
+    static constexpr float cos[2] = {1.0f, -0.5f};
+    static constexpr float sin[2] = {0.0f, 0.86602540378443865f};
+};
+
+template <>
+struct OddRoots<5>
+{
+    static constexpr float cos[3] = {1.0f, 0.30901699437494742f, -0.80901699437494742f};
+    static constexpr float sin[3] = {0.0f, 0.95105651629515357f, 0.58778525229247313f};
+};
+
+template <>
+struct OddRoots<7>
+{
+    static constexpr float cos[4] = {1.0f, 0.62348980185873353f, -0.22252093395631440f,
+                                     -0.90096886790241913f};
+    static constexpr float sin[4] = {0.0f, 0.78183148246802981f, 0.97492791218182361f,
+                                     0.43388373911755812f};
+};
+
+/*
+ * Odd R-Point DFT (3, 5, 7), Pairing Inputs j & R - j:
+ *   X[k] = A[k] -/+ i * B[k], X[R - k] = A[k] +/- i * B[k]
+ *   A[k] = a[0] + sum(cos(2πjk/R) * (a[j] + a[R - j]))
+ *   B[k] = sum(sin(2πjk/R) * (a[j] - a[R - j]))
+ */
+template <typename V, uint32_t R, bool Inverse>
+inline void dft_odd(const typename V::T* ar, const typename V::T* ai, typename V::T* xr,
+                    typename V::T* xi)
+{
+    using T = typename V::T;
+    constexpr uint32_t H = (R - 1) / 2;
+
+    T sr[H + 1], si[H + 1], dr[H + 1], di[H + 1];
+    T x0r = ar[0], x0i = ai[0];
+    for (uint32_t j = 1; j <= H; ++j)
+    {
+        sr[j] = V::add(ar[j], ar[R - j]);
+        si[j] = V::add(ai[j], ai[R - j]);
+        dr[j] = V::sub(ar[j], ar[R - j]);
+        di[j] = V::sub(ai[j], ai[R - j]);
+        x0r = V::add(x0r, sr[j]);
+        x0i = V::add(x0i, si[j]);
+    }
+    xr[0] = x0r;
+    xi[0] = x0i;
+
+    for (uint32_t k = 1; k <= H; ++k)
+    {
+        T a_re = ar[0], a_im = ai[0];
+        T b_re = V::set1(0.0f), b_im = V::set1(0.0f);
+        for (uint32_t j = 1; j <= H; ++j)
+        {
+            /* Fold jk mod R into 1 .. H, sin flips sign for the upper half */
+            const uint32_t m = (j * k) % R;
+            const bool upper = m > H;
+            const uint32_t idx = upper ? R - m : m;
+            const T c = V::set1(OddRoots<R>::cos[idx]);
+            const T sn = V::set1(upper ? -OddRoots<R>::sin[idx] : OddRoots<R>::sin[idx]);
+
+            a_re = V::fmadd(c, sr[j], a_re);
+            a_im = V::fmadd(c, si[j], a_im);
+            b_re = V::fmadd(sn, dr[j], b_re);
+            b_im = V::fmadd(sn, di[j], b_im);
+        }
+
+        if constexpr (Inverse)
+        {
+            xr[k] = V::sub(a_re, b_im);
+            xi[k] = V::add(a_im, b_re);
+            xr[R - k] = V::add(a_re, b_im);
+            xi[R - k] = V::sub(a_im, b_re);
+        }
+        else
+        {
+            xr[k] = V::add(a_re, b_im);
+            xi[k] = V::sub(a_im, b_re);
+            xr[R - k] = V::sub(a_re, b_im);
+            xi[R - k] = V::add(a_im, b_re);
+        }
+    }
+}
+
+template <typename V, uint32_t R, bool Inverse>
+inline void dft(const typename V::T* ar, const typename V::T* ai, typename V::T* xr,
+                typename V::T* xi)
+{
+    if constexpr (R == 2)
+        dft2<V, Inverse>(ar, ai, xr, xi);
+    else if constexpr (R == 4)
+        dft4<V, Inverse>(ar, ai, xr, xi);
+    else if constexpr (R == 8)
+        dft8<V, Inverse>(ar, ai, xr, xi);
+    else
+        dft_odd<V, R, Inverse>(ar, ai, xr, xi);
+}
+
+/*
+ * Radix-R Stage, Vectorized over q in [q_begin, q_end) (a Multiple of the Vector Width).
+ * The stride & count are either size_t (runtime schedules) or std::integral_constant (static
+ * schedules), in which case every loop bound & address offset is a compile-time constant.
+ */
+template <typename V, uint32_t R, bool Inverse, typename Stride, typename Count>
+void radix_stage(const float* x_re, const float* x_im, float* y_re, float* y_im,
+                 const float* twiddle_re, const float* twiddle_im, Stride s, Count m,
+                 size_t q_begin, size_t q_end)
+{
+    using T = typename V::T;
+
+    for (size_t p = 0; p < m; ++p)
+    {
+        T wr[R], wi[R];
+        for (uint32_t k = 1; k < R; ++k)
+        {
+            wr[k] = V::set1(twiddle_re[(k - 1) * m + p]);
+            wi[k] = V::set1(twiddle_im[(k - 1) * m + p]);
+        }
+
+        for (size_t q = q_begin; q < q_end; q += V::WIDTH)
+        {
+            T ar[R], ai[R], xr[R], xi[R];
+            for (uint32_t j = 0; j < R; ++j)
+            {
+                ar[j] = V::load(x_re + q + s * (p + j * m));
+                ai[j] = V::load(x_im + q + s * (p + j * m));
+            }
+
+            dft<V, R, Inverse>(ar, ai, xr, xi);
+
+            V::store(y_re + q + s * (R * p), xr[0]);
+            V::store(y_im + q + s * (R * p), xi[0]);
+            for (uint32_t k = 1; k < R; ++k)
+            {
+                cmul<V>(xr[k], xi[k], wr[k], wi[k]);
+                V::store(y_re + q + s * (R * p + k), xr[k]);
+                V::store(y_im + q + s * (R * p + k), xi[k]);
+            }
+        }
+    }
+}
+
+/*
+ * First Radix-8 Stage (Stride 1), Vectorized over p Instead of q.
+ * The eight outputs of each butterfly are adjacent in memory, so they are written with an 8x8
+ * in-register transpose rather than scattered.
+ */
+template <typename V, bool Inverse, typename Count>
+void radix8_first_stage(const float* x_re, const float* x_im, float* y_re, float* y_im,
+                        const float* twiddle_re, const float* twiddle_im, Count m)
+{
+    using T = typename V::T;
+
+    for (size_t p = 0; p < m; p += 8)
+    {
+        T ar[8], ai[8], xr[8], xi[8];
+        for (uint32_t j = 0; j < 8; ++j)
+        {
+            ar[j] = V::load(x_re + p + j * m);
+            ai[j] = V::load(x_im + p + j * m);
+        }
+
+        dft8<V, Inverse>(ar, ai, xr, xi);
+
+        for (uint32_t k = 1; k < 8; ++k)
+        {
+            const T wr = V::load(twiddle_re + (k - 1) * m + p);
+            const T wi = V::load(twiddle_im + (k - 1) * m + p);
+            cmul<V>(xr[k], xi[k], wr, wi);
+        }
+
+        V::transpose8(xr);
+        V::transpose8(xi);
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            V::store(y_re + 8 * (p + i), xr[i]);
+            V::store(y_im + 8 * (p + i), xi[i]);
+        }
+    }
+}
+
+/* Vector body over the largest multiple of the vector width, scalar tail for the rest of q */
+template <typename V, uint32_t R, bool Inverse, typename Stride, typename Count>
+void radix_stage(const float* x_re, const float* x_im, float* y_re, float* y_im,
+                 const float* twiddle_re, const float* twiddle_im, Stride s, Count m)
+{
+    const size_t body = s - s % V::WIDTH;
+    radix_stage<V, R, Inverse>(x_re, x_im, y_re, y_im, twiddle_re, twiddle_im, s, m, 0, body);
+    if constexpr (V::WIDTH > 1)
+    {
+        if (body < s)
+            radix_stage<ScalarVec, R, Inverse>(x_re, x_im, y_re, y_im, twiddle_re, twiddle_im, s,
+                                               m, body, s);
+    }
+}
+
+template <typename V, uint32_t R, bool Inverse>
+void radix_stage(const float* x_re, const float* x_im, float* y_re, float* y_im,
+                 const Stage& stage)
+{
+    radix_stage<V, R, Inverse>(x_re, x_im, y_re, y_im, stage.twiddle_re, stage.twiddle_im,
+                               (size_t)stage.stride, (size_t)stage.count);
+}
+
+template <typename V, bool Inverse>
+void run_stage(const float* x_re, const float* x_im, float* y_re, float* y_im, const Stage& stage)
+{
+    switch (stage.radix)
+    {
+    case 2:
+        radix_stage<V, 2, Inverse>(x_re, x_im, y_re, y_im, stage);
+        break;
+    case 3:
+        radix_stage<V, 3, Inverse>(x_re, x_im, y_re, y_im, stage);
+        break;
+    case 4:
+        radix_stage<V, 4, Inverse>(x_re, x_im, y_re, y_im, stage);
+        break;
+    case 5:
+        radix_stage<V, 5, Inverse>(x_re, x_im, y_re, y_im, stage);
+        break;
+    case 7:
+        radix_stage<V, 7, Inverse>(x_re, x_im, y_re, y_im, stage);
+        break;
+    default:
+        radix_stage<V, 8, Inverse>(x_re, x_im, y_re, y_im, stage);
+        break;
+    }
+}
+
+/* dst = src * scale */
+template <typename V>
+void scale_copy(const float* src, float* dst, uint32_t size, float scale)
+{
+    uint32_t i = 0;
+    for (; i + V::WIDTH <= size; i += V::WIDTH)
+        V::store(dst + i, V::mul(V::load(src + i), V::set1(scale)));
+    for (; i < size; ++i)
+        dst[i] = src[i] * scale;
+}
+
+/*
+ * Runs all stages on one sequence, ping-ponging with the scratch buffers.
+ * Each stage uses the widest vector type that fits in its stride (with a scalar tail).
+ */
+template <typename Wide, typename Narrow, bool Inverse>
+void transform(float* re, float* im, uint32_t size, const Stage* stages, uint32_t stage_count,
+               float* scratch_re, float* scratch_im)
+{
+    const float* src_re = re;
+    const float* src_im = im;
+    float* dst_re = scratch_re;
+    float* dst_im = scratch_im;
+
+    for (uint32_t i = 0; i < stage_count; ++i)
+    {
+        const Stage& stage = stages[i];
+        if (stage.stride >= Wide::WIDTH)
+            run_stage<Wide, Inverse>(src_re, src_im, dst_re, dst_im, stage);
+        else if (stage.stride >= Narrow::WIDTH)
+            run_stage<Narrow, Inverse>(src_re, src_im, dst_re, dst_im, stage);
+        else if constexpr (Narrow::WIDTH == 8)
+        {
+            if (stage.stride == 1 && stage.radix == 8 && stage.count % 8 == 0)
+                radix8_first_stage<Narrow, Inverse>(src_re, src_im, dst_re, dst_im,
+                                                    stage.twiddle_re, stage.twiddle_im,
+                                                    (size_t)stage.count);
+            else
+                run_stage<ScalarVec, Inverse>(src_re, src_im, dst_re, dst_im, stage);
+        }
+        else
+            run_stage<ScalarVec, Inverse>(src_re, src_im, dst_re, dst_im, stage);
+
+        /* The destination becomes the next source, the old source becomes the next scratch */
+        float* next_re = src_re == re ? re : scratch_re;
+        float* next_im = src_im == im ? im : scratch_im;
+        src_re = dst_re;
+        src_im = dst_im;
+        dst_re = next_re;
+        dst_im = next_im;
+    }
+
+    const float scale = Inverse ? (1.0f / (float)size) : 1.0f;
+    if (src_re != re || scale != 1.0f)
+    {
+        scale_copy<Wide>(src_re, re, size, scale);
+        scale_copy<Wide>(src_im, im, size, scale);
+    }
+}
+
+template <typename Wide, typename Narrow>
+void transform_rows(float* re, float* im, size_t row_stride, uint32_t rows, uint32_t size,
+                    const Stage* stages, uint32_t stage_count, Direction direction,
+                    float* scratch_re, float* scratch_im)
+{
+    for (uint32_t y = 0; y < rows; ++y)
+    {
+        float* row_re = re + y * row_stride;
+        float* row_im = im + y * row_stride;
+        if (direction == Direction::INVERSE)
+            transform<Wide, Narrow, true>(row_re, row_im, size, stages, stage_count, scratch_re,
+                                          scratch_im);
+        else
+            transform<Wide, Narrow, false>(row_re, row_im, size, stages, stage_count, scratch_re,
+                                           scratch_im);
+    }
+}
+
+/*
+ * Stage I of a Static Size: the radix, stride, count, twiddle offset & ping-pong direction are all
+ * compile-time constants, and so is the choice of vector type.
+ */
+template <typename Wide, typename Narrow, uint32_t Size, bool Inverse, uint32_t I>
+inline void static_stage(float* re, float* im, float* scratch_re, float* scratch_im)
+{
+    constexpr auto stages = StaticSchedule<Size>::STAGES;
+    constexpr uint32_t R = stages.radix[I];
+    constexpr size_t S = stages.stride[I];
+    constexpr size_t M = Size / S / R;
+    using Stride = std::integral_constant<size_t, S>;
+    using Count = std::integral_constant<size_t, M>;
+
+    /* Even stages read the row & write the scratch, odd stages the other way around */
+    const float* x_re = I % 2 == 0 ? re : scratch_re;
+    const float* x_im = I % 2 == 0 ? im : scratch_im;
+    float* y_re = I % 2 == 0 ? scratch_re : re;
+    float* y_im = I % 2 == 0 ? scratch_im : im;
+
+    constexpr const StaticTwiddles<Size, Inverse>& twiddles = STATIC_TWIDDLES<Size, Inverse>;
+    const float* w_re = twiddles.re + stages.offset[I];
+    const float* w_im = twiddles.im + stages.offset[I];
+
+    if constexpr (S >= Wide::WIDTH)
+        radix_stage<Wide, R, Inverse>(x_re, x_im, y_re, y_im, w_re, w_im, Stride{}, Count{});
+    else if constexpr (S >= Narrow::WIDTH)
+        radix_stage<Narrow, R, Inverse>(x_re, x_im, y_re, y_im, w_re, w_im, Stride{}, Count{});
+    else if constexpr (Narrow::WIDTH == 8 && S == 1 && R == 8 && M % 8 == 0)
+        radix8_first_stage<Narrow, Inverse>(x_re, x_im, y_re, y_im, w_re, w_im, Count{});
+    else
+        radix_stage<ScalarVec, R, Inverse>(x_re, x_im, y_re, y_im, w_re, w_im, Stride{}, Count{});
+}
+
+/* Runs All Stages of a Static Size, Unrolled at Compile Time */
+template <typename Wide, typename Narrow, uint32_t Size, bool Inverse, uint32_t... I>
+inline void static_transform(float* re, float* im, float* scratch_re, float* scratch_im,
+                             std::integer_sequence<uint32_t, I...>)
+{
+    (static_stage<Wide, Narrow, Size, Inverse, I>(re, im, scratch_re, scratch_im), ...);
+
+    /* An odd stage count leaves the result in the scratch buffers */
+    constexpr bool in_scratch = sizeof...(I) % 2 == 1;
+    if constexpr (in_scratch || Inverse)
+    {
+        const float scale = Inverse ? (1.0f / (float)Size) : 1.0f;
+        scale_copy<Wide>(in_scratch ? scratch_re : re, re, Size, scale);
+        scale_copy<Wide>(in_scratch ? scratch_im : im, im, Size, scale);
+    }
+}
+
+/* StaticTransformRowsFn of One Size (see kernels.hpp) */
+template <typename Wide, typename Narrow, uint32_t Size>
+void transform_static_rows(float* re, float* im, size_t row_stride, uint32_t rows,
+                           Direction direction, float* scratch_re, float* scratch_im)
+{
+    using Stages = std::make_integer_sequence<uint32_t, StaticSchedule<Size>::STAGE_COUNT>;
+    for (uint32_t y = 0; y < rows; ++y)
+    {
+        float* row_re = re + y * row_stride;
+        float* row_im = im + y * row_stride;
+        if (direction == Direction::INVERSE)
+            static_transform<Wide, Narrow, Size, true>(row_re, row_im, scratch_re, scratch_im,
+                                                      Stages{});
+        else
+            static_transform<Wide, Narrow, Size, false>(row_re, row_im, scratch_re, scratch_im,
+                                                       Stages{});
+    }
+}
+
+/* Fills the Kernel Table of the Static Sizes (256 - 4096) */
+template <typename Wide, typename Narrow>
+void static_kernels(StaticTransformRowsFn (&kernels)[STATIC_SIZE_COUNT])
+{
+    kernels[static_size_index(256)] = transform_static_rows<Wide, Narrow, 256>;
+    kernels[static_size_index(512)] = transform_static_rows<Wide, Narrow, 512>;
+    kernels[static_size_index(1024)] = transform_static_rows<Wide, Narrow, 1024>;
+    kernels[static_size_index(2048)] = transform_static_rows<Wide, Narrow, 2048>;
+    kernels[static_size_index(4096)] = transform_static_rows<Wide, Narrow, 4096>;
+}
+
+} // namespace
+} // namespace fft
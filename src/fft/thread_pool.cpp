@@ -0,0 +1,214 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+namespace fft
+{
+
+/*
+ * Queue owned by the current thread (workers own theirs, other threads share the last one). Sharing
+ * it is safe: a waiting caller only takes the tasks of its own job, whichever queue they are in.
+ */
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local uint32_t current_queue = 0;
+
+/* Yields of a Waiting Caller Finding None of its Chunks Queued Before it Sleeps */
+constexpr uint32_t WAIT_SPINS = 64;
+
+ThreadPool::ThreadPool(uint32_t thread_count)
+{
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    const uint32_t worker_count = thread_count - 1;
+    for (uint32_t i = 0; i < worker_count + 1; ++i)
+        queues.push_back(std::make_unique<Queue>());
+
+    for (uint32_t i = 0; i < worker_count; ++i)
+        workers.emplace_back([this, i]() { worker_loop(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallel_for(size_t count, size_t grain,
+                              const std::function<void(size_t, size_t)>& fn)
+{
+    if (count == 0)
+        return;
+    if (grain == 0)
+        grain = 1;
+
+    /* Not worth waking anyone up */
+    if (workers.empty() || count <= grain)
+    {
+        fn(0, count);
+        return;
+    }
+
+    const uint32_t own_queue = current_pool == this ? current_queue : (uint32_t)workers.size();
+    const size_t chunks = (count + grain - 1) / grain;
+
+    Job job{};
+    job.fn = &fn;
+    job.remaining.store(chunks);
+
+    /* Counted before they are visible, so a worker popping one never takes pending below zero */
+    pending.fetch_add(chunks);
+
+    /* Deal the chunks out round-robin, starting with our own queue */
+    for (size_t i = 0; i < chunks; ++i)
+    {
+        Task task{};
+        task.job = &job;
+        task.begin = i * grain;
+        task.end = std::min(count, task.begin + grain);
+
+        Queue& queue = *queues[(own_queue + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    wake.notify_all();
+
+    /*
+     * Help out until our job is done, with its own tasks only: running another job's task here
+     * could start it in the middle of the caller's work (e.g. a second tile while the first one
+     * holds the thread_local FFT scratch)
+     */
+    const ThreadPool* previous_pool = current_pool;
+    const uint32_t previous_queue = current_queue;
+    current_pool = this;
+    current_queue = own_queue;
+
+    for (uint32_t attempt = 0; job.remaining.load() > 0 && attempt < WAIT_SPINS; ++attempt)
+    {
+        Task task{};
+        if (pop_task(own_queue, task, &job))
+        {
+            run_task(task);
+            attempt = 0;
+        }
+        else
+            std::this_thread::yield();
+    }
+
+    /*
+     * Chunks are never queued again, so the rest is running on other threads: sleep until the last
+     * one is done. Waiting on the mutex also keeps `job` alive until its finisher let go of it.
+     */
+    {
+        std::unique_lock<std::mutex> lock(job.mutex);
+        job.finished.wait(lock, [&job]() { return job.done; });
+    }
+
+    current_pool = previous_pool;
+    current_queue = previous_queue;
+}
+
+void ThreadPool::worker_loop(uint32_t index)
+{
+    current_pool = this;
+    current_queue = index;
+
+    while (true)
+    {
+        Task task{};
+        if (pop_task(index, task))
+        {
+            run_task(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this]() { return stopping || pending.load() > 0; });
+        if (stopping && pending.load() == 0)
+            return;
+    }
+}
+
+bool ThreadPool::pop_task(uint32_t index, Task& task, const Job* job)
+{
+    auto is_eligible = [job](const Task& candidate) { return !job || candidate.job == job; };
+
+    /* Newest task from our own queue first (it is the most likely to still be in cache) */
+    {
+        Queue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        const auto it = std::find_if(queue.tasks.rbegin(), queue.tasks.rend(), is_eligible);
+        if (it != queue.tasks.rend())
+        {
+            task = *it;
+            queue.tasks.erase(std::next(it).base());
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    /* Then steal the oldest task from someone else */
+    for (size_t i = 1; i < queues.size(); ++i)
+    {
+        Queue& queue = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        const auto it = std::find_if(queue.tasks.begin(), queue.tasks.end(), is_eligible);
+        if (it != queue.tasks.end())
+        {
+            task = *it;
+            queue.tasks.erase(it);
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run_task(const Task& task)
+{
+    Job& job = *task.job;
+    (*job.fn)(task.begin, task.end);
+    if (job.remaining.fetch_sub(1) == 1)
+    {
+        std::lock_guard<std::mutex> lock(job.mutex);
+        job.done = true;
+        job.finished.notify_one();
+    }
+}
+
+static std::mutex pool_mutex{};
+static std::unique_ptr<ThreadPool> pool{};
+
+ThreadPool& get_thread_pool()
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    if (!pool)
+    {
+        uint32_t thread_count = 0;
+        if (const char* env = std::getenv("LUCEO_THREADS"))
+            thread_count = (uint32_t)std::strtoul(env, nullptr, 10);
+
+        pool = std::make_unique<ThreadPool>(thread_count);
+    }
+    return *pool;
+}
+
+void set_thread_count(uint32_t thread_count)
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    pool = std::make_unique<ThreadPool>(thread_count);
+}
+
+} // namespace fft
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fft
+{
+
+/*
+ * Work-Stealing Thread Pool.
+ * Every worker owns a deque of tasks, it pops from the back of its own deque and steals from the
+ * front of the others when it runs dry. The thread calling parallel_for helps out until its job is
+ * done, so nested parallel_for calls from inside a task cannot deadlock.
+ *
+ * Reentrancy: while it waits, the caller only runs chunks of the job it submitted, never tasks of
+ * other jobs. So thread_local state the caller holds across a parallel_for (the FFT scratch planes)
+ * is only touched by fn itself, which must not use that state for anything else. Idle workers
+ * still run any job's tasks.
+ */
+class ThreadPool
+{
+  public:
+    /* 0 threads = one per hardware thread */
+    explicit ThreadPool(uint32_t thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /* Number of threads working on a job (the workers plus the calling thread) */
+    uint32_t get_thread_count() const { return (uint32_t)workers.size() + 1; }
+
+    /*
+     * Calls fn(begin, end) for chunks of at most `grain` items covering [0, count).
+     * Blocks until every chunk has finished: the caller runs queued chunks, then spins briefly and
+     * sleeps while the last ones finish on other threads.
+     */
+    void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+  private:
+    struct Job
+    {
+        const std::function<void(size_t, size_t)>* fn = nullptr;
+        std::atomic<size_t> remaining{0};
+
+        /* Set by whoever finishes the last chunk, the caller sleeps on it once none are queued */
+        std::mutex mutex{};
+        std::condition_variable finished{};
+        bool done = false;
+    };
+
+    struct Task
+    {
+        Job* job = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex{};
+        std::deque<Task> tasks{};
+    };
+
+    void worker_loop(uint32_t index);
+    /* Pops a task, any task for a worker, only the tasks of `job` for a waiting caller */
+    bool pop_task(uint32_t index, Task& task, const Job* job = nullptr);
+    void run_task(const Task& task);
+
+  private:
+    std::vector<std::thread> workers{};
+    /* One queue per worker, plus one for threads outside the pool (the last one) */
+    std::vector<std::unique_ptr<Queue>> queues{};
+
+    std::mutex sleep_mutex{};
+    std::condition_variable wake{};
+    std::atomic<size_t> pending{0};
+    bool stopping = false;
+};
+
+/* Returns the Pool Used by the CPU FFT (Sized by LUCEO_THREADS, or One Thread per Core) */
+ThreadPool& get_thread_pool();
+
+/* Pins the FFT Pool Size (0 = One Thread per Core), Must Not be Called While a Transform Runs */
+void set_thread_count(uint32_t thread_count);
+
+} // namespace fft
@@ -0,0 +1,187 @@
+#include "hdr_reader.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include "fft/thread_pool.hpp"
+#include "rgbe.hpp"
+
+namespace io
+{
+
+/* Scanlines Decoded per Task */
+constexpr size_t HDR_ROW_GRAIN = 8;
+
+/* Reads a Header Line (Without the Newline), Returns False at the End of the File */
+static bool read_line(const uint8_t* data, size_t size, size_t& offset, std::string& line)
+{
+    if (offset >= size)
+        return false;
+
+    const uint8_t* begin = data + offset;
+    const uint8_t* end = (const uint8_t*)std::memchr(begin, '\n', size - offset);
+    const size_t length = end ? (size_t)(end - begin) : size - offset;
+    line.assign((const char*)begin, length);
+    offset += length + (end ? 1 : 0);
+    return true;
+}
+
+bool HdrReader::open(const std::string& path)
+{
+    close();
+    if (!file.open(path.c_str()))
+        return false;
+
+    const uint8_t* data = file.data();
+    const size_t size = file.size();
+    size_t offset = 0;
+    std::string line{};
+
+    /* "#?RADIANCE" (or "#?RGBE"), then variables up to an empty line */
+    if (!read_line(data, size, offset, line) || line.compare(0, 2, "#?") != 0)
+    {
+        close();
+        return false;
+    }
+
+    bool rgbe_format = false;
+    while (read_line(data, size, offset, line) && !line.empty())
+    {
+        if (line.compare(0, 7, "FORMAT=") == 0)
+            rgbe_format = line == "FORMAT=32-bit_rle_rgbe";
+    }
+
+    /* Resolution string, flipped or rotated images are left to stb_image */
+    int h = 0, w = 0;
+    if (!rgbe_format || !read_line(data, size, offset, line) ||
+        sscanf(line.c_str(), "-Y %d +X %d", &h, &w) != 2 || w <= 0 || h <= 0)
+    {
+        close();
+        return false;
+    }
+
+    width = (uint32_t)w;
+    height = (uint32_t)h;
+    if (!index_scanlines(offset))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void HdrReader::close()
+{
+    file.close();
+    width = height = 0;
+    run_length_encoded = false;
+    scanlines.clear();
+}
+
+bool HdrReader::index_scanlines(size_t offset)
+{
+    const uint8_t* data = file.data();
+    const size_t size = file.size();
+    scanlines.resize(height);
+
+    /* Like stb_image the first scanline decides, RLE needs a width of 8 - 32767 */
+    run_length_encoded = width >= 8 && width < 32768 && offset + 4 <= size && data[offset] == 2 &&
+                         data[offset + 1] == 2 && !(data[offset + 2] & 0x80);
+
+    if (!run_length_encoded)
+    {
+        const size_t row_bytes = (size_t)width * 4;
+        if (size - offset < row_bytes * height)
+            return false;
+
+        /* The old RLE scheme (runs marked by 1, 1, 1 pixels) is not supported */
+        if (data[offset] == 1 && data[offset + 1] == 1 && data[offset + 2] == 1)
+            return false;
+
+        for (uint32_t y = 0; y < height; ++y)
+            scanlines[y] = offset + y * row_bytes;
+        return true;
+    }
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        /* 2, 2, width (big endian), then 4 channel planes of runs */
+        if (offset + 4 > size || data[offset] != 2 || data[offset + 1] != 2 ||
+            (((uint32_t)data[offset + 2] << 8) | data[offset + 3]) != width)
+            return false;
+        scanlines[y] = offset;
+        offset += 4;
+
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            for (uint32_t x = 0; x < width;)
+            {
+                if (offset >= size)
+                    return false;
+
+                /* Above 128 a run of one repeated byte, otherwise that many literal bytes */
+                uint32_t count = data[offset++];
+                if (count > 128)
+                {
+                    count -= 128;
+                    offset += 1;
+                }
+                else
+                    offset += count;
+
+                x += count;
+                if (count == 0 || x > width || offset > size)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+void HdrReader::decode_scanline(uint32_t y, uint8_t* rgbe) const
+{
+    /* The runs were validated by index_scanlines */
+    const uint8_t* src = file.data() + scanlines[y] + 4;
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        for (uint32_t x = 0; x < width;)
+        {
+            uint32_t count = *src++;
+            if (count > 128)
+            {
+                count -= 128;
+                const uint8_t value = *src++;
+                for (uint32_t i = 0; i < count; ++i)
+                    rgbe[(size_t)(x + i) * 4 + c] = value;
+            }
+            else
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                    rgbe[(size_t)(x + i) * 4 + c] = *src++;
+            }
+            x += count;
+        }
+    }
+}
+
+void HdrReader::decode(float* dst, size_t row_stride) const
+{
+    const RgbeToFloatFn rgbe_to_float = get_rgbe_to_float();
+
+    fft::get_thread_pool().parallel_for(height, HDR_ROW_GRAIN, [&](size_t begin, size_t end) {
+        std::vector<uint8_t> rgbe(run_length_encoded ? (size_t)width * 4 : 0);
+        for (size_t y = begin; y < end; ++y)
+        {
+            /* Flat scanlines are converted straight from the mapped file */
+            const uint8_t* src = file.data() + scanlines[y];
+            if (run_length_encoded)
+            {
+                decode_scanline((uint32_t)y, rgbe.data());
+                src = rgbe.data();
+            }
+            rgbe_to_float(src, dst + y * row_stride, width);
+        }
+    });
+}
+
+} // namespace io
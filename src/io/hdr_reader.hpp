@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+
+namespace io
+{
+
+/*
+ * Radiance .hdr (RGBE) Reader.
+ * The file is memory mapped and its scanlines are indexed up front (run-length encoded ones have
+ * to be walked to find where the next one starts, which only reads the run headers), so they can
+ * then be decoded in parallel on the FFT thread pool. RGBE -> float is SIMD too (rgbe.hpp).
+ * Only the standard "-Y height +X width" orientation is supported.
+ */
+class HdrReader
+{
+  public:
+    /* Maps the File, Parses the Header & Indexes the Scanlines, False if Unsupported or Corrupt */
+    bool open(const std::string& path);
+    void close();
+
+    uint32_t get_width() const { return width; }
+    uint32_t get_height() const { return height; }
+
+    /* Decodes the Image Into dst as RGBA32F (Alpha 1), Rows are `row_stride` Floats Apart */
+    void decode(float* dst, size_t row_stride) const;
+
+  private:
+    bool index_scanlines(size_t offset);
+    void decode_scanline(uint32_t y, uint8_t* rgbe) const;
+
+  private:
+    MappedFile file{};
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    /* Flat scanlines are stored as is, RLE ones as 4 run-length encoded channel planes */
+    bool run_length_encoded = false;
+    std::vector<size_t> scanlines{};
+};
+
+} // namespace io
@@ -0,0 +1,208 @@
+#include "image_io.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "hdr_reader.hpp"
+#include "image_writer.hpp"
+
+namespace io
+{
+
+ImageFormat get_image_format(const std::string& path)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return (char)std::tolower(c); });
+
+    if (extension == ".hdr")
+        return ImageFormat::HDR;
+    if (extension == ".pfm")
+        return ImageFormat::PFM;
+    if (extension == ".rgbaf")
+        return ImageFormat::RAW;
+    if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+        extension == ".tga" || extension == ".bmp")
+        return ImageFormat::LDR;
+    return ImageFormat::UNKNOWN;
+}
+
+/* Reads the Next Whitespace Separated Header Token of a PFM File, Consuming One Whitespace After */
+static bool read_token(const MappedFile& file, size_t& offset, std::string& token)
+{
+    const uint8_t* data = file.data();
+    const size_t size = file.size();
+    while (offset < size && std::isspace(data[offset]))
+        ++offset;
+
+    const size_t begin = offset;
+    while (offset < size && !std::isspace(data[offset]))
+        ++offset;
+    token.assign((const char*)data + begin, offset - begin);
+
+    if (offset < size)
+        ++offset;
+    return !token.empty();
+}
+
+static float swap_bytes(float value)
+{
+    uint8_t bytes[4];
+    std::memcpy(bytes, &value, 4);
+    std::swap(bytes[0], bytes[3]);
+    std::swap(bytes[1], bytes[2]);
+    std::memcpy(&value, bytes, 4);
+    return value;
+}
+
+static bool load_pfm(const std::string& path, fft::ImageRGBA& image)
+{
+    MappedFile file{};
+    if (!file.open(path.c_str()))
+        return false;
+
+    /* "PF" (RGB) or "Pf" (grey), width, height, scale (negative = little endian) */
+    size_t offset = 0;
+    std::string magic{}, width_token{}, height_token{}, scale_token{};
+    if (!read_token(file, offset, magic) || !read_token(file, offset, width_token) ||
+        !read_token(file, offset, height_token) || !read_token(file, offset, scale_token) ||
+        (magic != "PF" && magic != "Pf"))
+        return false;
+
+    const uint32_t channels = magic[1] == 'F' ? 3 : 1;
+    const long width = strtol(width_token.c_str(), nullptr, 10);
+    const long height = strtol(height_token.c_str(), nullptr, 10);
+    const bool little_endian = strtod(scale_token.c_str(), nullptr) < 0.0;
+    const size_t row_floats = (size_t)width * channels;
+    if (width <= 0 || height <= 0 || file.size() - offset < row_floats * height * sizeof(float))
+        return false;
+
+    image.resize((uint32_t)width, (uint32_t)height);
+    const bool swap = little_endian != is_little_endian();
+
+    /* The rows are stored bottom to top, converted straight from the mapped file */
+    const uint8_t* rows = file.data() + offset;
+    for (long y = 0; y < height; ++y)
+    {
+        const uint8_t* row = rows + (size_t)(height - 1 - y) * row_floats * sizeof(float);
+        float* pixel = &image.pixels[(size_t)y * width * 4];
+        for (long x = 0; x < width; ++x, pixel += 4)
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                float value = 0.0f;
+                const size_t index = (size_t)x * channels + (channels == 3 ? c : 0);
+                std::memcpy(&value, row + index * sizeof(float), sizeof(float));
+                pixel[c] = swap ? swap_bytes(value) : value;
+            }
+            pixel[3] = 1.0f;
+        }
+    }
+    return true;
+}
+
+bool load_image(const std::string& path, fft::ImageRGBA& image)
+{
+    const ImageFormat format = get_image_format(path);
+    if (format == ImageFormat::PFM)
+        return load_pfm(path, image);
+
+    /* Copied out of the mapping, use ImageFile to work on the mapped pixels directly */
+    if (format == ImageFormat::RAW)
+    {
+        ImageFile file{};
+        if (!file.open(path))
+            return false;
+
+        const fft::ImageView& view = file.view();
+        image.width = view.width;
+        image.height = view.height;
+        image.pixels.assign(view.pixels, view.pixels + (size_t)view.width * view.height * 4);
+        return true;
+    }
+
+    /* Decoded in parallel, files the reader does not support are left to stb_image */
+    if (format == ImageFormat::HDR)
+    {
+        HdrReader reader{};
+        if (reader.open(path))
+        {
+            image.width = reader.get_width();
+            image.height = reader.get_height();
+            image.pixels.resize((size_t)image.width * image.height * 4);
+            reader.decode(image.pixels.data(), (size_t)image.width * 4);
+            return true;
+        }
+    }
+
+    int width = 0, height = 0, channels = 0;
+    float* data = stbi_loadf(path.c_str(), &width, &height, &channels, 4);
+    if (!data)
+        return false;
+
+    image.width = (uint32_t)width;
+    image.height = (uint32_t)height;
+    image.pixels.assign(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+    return true;
+}
+
+bool save_image(const std::string& path, const fft::ImageRGBA& image)
+{
+    ImageWriter writer{};
+    return writer.open(path, image.width, image.height) &&
+           writer.write_rows(image.pixels.data(), (size_t)image.width * 4, image.height) &&
+           writer.close();
+}
+
+bool ImageFile::open(const std::string& path)
+{
+    close();
+    if (get_image_format(path) != ImageFormat::RAW)
+    {
+        if (!load_image(path, decoded))
+            return false;
+        image = decoded;
+        return true;
+    }
+
+    if (!is_little_endian() || !file.open(path.c_str()) || file.size() < sizeof(RawHeader))
+    {
+        close();
+        return false;
+    }
+
+    RawHeader header{};
+    std::memcpy(&header, file.data(), sizeof(header));
+    const size_t pixel_bytes = (size_t)header.width * header.height * 4 * sizeof(float);
+    if (std::memcmp(header.magic, RAW_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != RAW_VERSION || header.channels != 4 || header.width == 0 ||
+        header.height == 0 || file.size() - sizeof(header) < pixel_bytes)
+    {
+        close();
+        return false;
+    }
+
+    /* The mapping is page aligned, so the pixels are 64 byte aligned */
+    image.width = header.width;
+    image.height = header.height;
+    image.pixels = (const float*)(file.data() + sizeof(header));
+    return true;
+}
+
+void ImageFile::close()
+{
+    file.close();
+    decoded = fft::ImageRGBA{};
+    image = fft::ImageView{};
+}
+
+} // namespace io
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "fft/convolution.hpp"
+#include "mapped_file.hpp"
+
+/* Loading & Storing of Linear RGBA32F Images */
+namespace io
+{
+
+/* File Formats, Picked by the Extension of the Path */
+enum class ImageFormat
+{
+    UNKNOWN,
+    HDR, /* Radiance RGBE (.hdr) */
+    PFM, /* Portable float map (.pfm) */
+    RAW, /* Raw little endian RGBA32F rows, top to bottom, behind a 64 byte header (.rgbaf) */
+    LDR  /* Anything else stb_image reads (.png, .jpg, ...), loading only */
+};
+
+ImageFormat get_image_format(const std::string& path);
+
+/* Bump When the Raw Layout Changes */
+constexpr uint32_t RAW_VERSION = 1;
+constexpr char RAW_MAGIC[8] = {'L', 'U', 'C', 'E', 'O', 'R', 'A', 'W'};
+
+/* Header of the Raw Format, Padded to 64 Bytes so the Rows Start Cache Line Aligned */
+struct RawHeader
+{
+    char magic[8]{};
+    uint32_t version = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t channels = 0; /* Always 4 (RGBA) */
+    uint8_t padding[40]{};
+};
+static_assert(sizeof(RawHeader) == 64, "the raw rows should start at 64 bytes");
+
+inline bool is_little_endian()
+{
+    const uint32_t one = 1;
+    uint8_t first = 0;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+/* Loads the Image as RGBA32F (Alpha is 1 if the File Has None), Returns False on Failure */
+bool load_image(const std::string& path, fft::ImageRGBA& image);
+
+/* Stores the Image as .hdr, .pfm (RGB Channels Only) or .rgbaf, Returns False on Failure */
+bool save_image(const std::string& path, const fft::ImageRGBA& image);
+
+/*
+ * An Image Opened for Reading. Raw (.rgbaf) files are memory mapped and their pixels are used in
+ * place, so they go to upload_texture or the CPU FFT without a decode buffer. Other formats are
+ * decoded into pixels owned by the object (PFM in one pass over the mapped file). The view stays
+ * valid until the file is closed or destroyed, moving the object keeps it valid.
+ */
+class ImageFile
+{
+  public:
+    bool open(const std::string& path);
+    void close();
+
+    const fft::ImageView& view() const { return image; }
+    size_t size_bytes() const { return (size_t)image.width * image.height * 4 * sizeof(float); }
+
+    /* True if the View Points Into the Mapped File */
+    bool is_mapped() const { return file.is_open(); }
+
+  private:
+    MappedFile file{};
+    fft::ImageRGBA decoded{};
+    fft::ImageView image{};
+};
+
+} // namespace io
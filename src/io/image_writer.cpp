@@ -0,0 +1,225 @@
+#include "image_writer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace io
+{
+
+/* 64-Bit File Offsets (long is 32 Bits on Windows, PFM Files Over 2 GB Would Seek Wrongly) */
+static bool seek_to(FILE* file, int64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static int64_t tell(FILE* file)
+{
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return (int64_t)ftello(file);
+#endif
+}
+
+/*
+ * Shared Exponent Encoding of a Linear RGB Pixel. Negative & NaN channels are written as 0,
+ * anything past the largest RGBE value (255 * 2^119, e.g. +inf) saturates at it.
+ */
+static void to_rgbe(const float* rgb, uint8_t* rgbe)
+{
+    float channels[3];
+    for (uint32_t c = 0; c < 3; ++c)
+        channels[c] = rgb[c] > 0.0f ? std::min(rgb[c], std::numeric_limits<float>::max()) : 0.0f;
+
+    const float v = std::max({channels[0], channels[1], channels[2]});
+    if (v < 1e-32f)
+    {
+        rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+        return;
+    }
+
+    /* The exponent byte is exponent + 128, so it stops at 127 & the mantissas absorb the rest */
+    int exponent = 0;
+    std::frexp(v, &exponent);
+    exponent = std::min(exponent, 127);
+    const float scale = std::ldexp(256.0f, -exponent);
+    rgbe[0] = (uint8_t)std::min(channels[0] * scale, 255.0f);
+    rgbe[1] = (uint8_t)std::min(channels[1] * scale, 255.0f);
+    rgbe[2] = (uint8_t)std::min(channels[2] * scale, 255.0f);
+    rgbe[3] = (uint8_t)(exponent + 128);
+}
+
+/*
+ * Run-Length Encodes One Channel of a Scanline (Every 4th Byte of rgbe).
+ * A count above 128 repeats the next byte count - 128 times, otherwise count literal bytes follow.
+ * Runs shorter than 4 are not worth their 2 bytes, they stay in the literals.
+ */
+static void encode_channel(const uint8_t* rgbe, uint32_t width, std::vector<uint8_t>& out)
+{
+    auto at = [&](uint32_t x) { return rgbe[(size_t)x * 4]; };
+
+    uint32_t x = 0;
+    while (x < width)
+    {
+        /* Find the start of the next run of at least 4 */
+        uint32_t run_start = x;
+        while (run_start + 3 < width &&
+               !(at(run_start) == at(run_start + 1) && at(run_start) == at(run_start + 2) &&
+                 at(run_start) == at(run_start + 3)))
+            ++run_start;
+        if (run_start + 3 >= width)
+            run_start = width;
+
+        /* Literals up to it */
+        while (x < run_start)
+        {
+            const uint32_t count = std::min(128u, run_start - x);
+            out.push_back((uint8_t)count);
+            for (uint32_t i = 0; i < count; ++i)
+                out.push_back(at(x + i));
+            x += count;
+        }
+
+        if (run_start == width)
+            break;
+
+        uint32_t count = 1;
+        while (run_start + count < width && count < 127 && at(run_start + count) == at(run_start))
+            ++count;
+        out.push_back((uint8_t)(128 + count));
+        out.push_back(at(run_start));
+        x = run_start + count;
+    }
+}
+
+ImageWriter::~ImageWriter()
+{
+    close();
+}
+
+bool ImageWriter::open(const std::string& path, uint32_t new_width, uint32_t new_height)
+{
+    close();
+
+    format = get_image_format(path);
+    if (format != ImageFormat::HDR && format != ImageFormat::PFM && format != ImageFormat::RAW)
+    {
+        printf("unsupported output format: %s (use .hdr, .pfm or .rgbaf).\n", path.c_str());
+        return false;
+    }
+    if (new_width == 0 || new_height == 0)
+        return false;
+
+    file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    width = new_width;
+    height = new_height;
+    next_row = 0;
+    ok = true;
+
+    switch (format)
+    {
+    case ImageFormat::HDR:
+        ok = fprintf(file, "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %u +X %u\n", height,
+                     width) > 0;
+        rgbe.resize((size_t)width * 4);
+        break;
+    case ImageFormat::PFM:
+        ok = fprintf(file, "PF\n%u %u\n%s\n", width, height,
+                     is_little_endian() ? "-1.0" : "1.0") > 0;
+        rgb.resize((size_t)width * 3);
+        break;
+    default: {
+        /* Floats are written as they are in memory, only little endian hosts are supported */
+        RawHeader header{};
+        std::memcpy(header.magic, RAW_MAGIC, sizeof(header.magic));
+        header.version = RAW_VERSION;
+        header.width = width;
+        header.height = height;
+        header.channels = 4;
+        ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        break;
+    }
+    }
+
+    data_offset = tell(file);
+    return ok;
+}
+
+bool ImageWriter::write_hdr_row(const float* row)
+{
+    for (uint32_t x = 0; x < width; ++x)
+        to_rgbe(row + (size_t)x * 4, &rgbe[(size_t)x * 4]);
+
+    /* Widths outside 8 - 32767 cannot be run-length encoded, those scanlines stay flat */
+    if (width < 8 || width > 32767)
+        return fwrite(rgbe.data(), 1, rgbe.size(), file) == rgbe.size();
+
+    encoded.clear();
+    encoded.push_back(2);
+    encoded.push_back(2);
+    encoded.push_back((uint8_t)(width >> 8));
+    encoded.push_back((uint8_t)(width & 0xFF));
+    for (uint32_t c = 0; c < 4; ++c)
+        encode_channel(rgbe.data() + c, width, encoded);
+    return fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+}
+
+bool ImageWriter::write_rows(const float* rows, size_t row_stride, uint32_t count)
+{
+    if (!file || !ok || next_row + count > height)
+        return ok = false;
+
+    if (format == ImageFormat::PFM)
+    {
+        /* Bottom to top: the band goes to the end of the rows not written yet */
+        for (uint32_t i = 0; i < count && ok; ++i)
+        {
+            const float* pixel = rows + i * row_stride;
+            for (uint32_t x = 0; x < width; ++x, pixel += 4)
+                std::copy(pixel, pixel + 3, &rgb[(size_t)x * 3]);
+
+            const size_t row_bytes = rgb.size() * sizeof(float);
+            const int64_t offset =
+                data_offset + (int64_t)(height - 1 - (next_row + i)) * (int64_t)row_bytes;
+            ok = seek_to(file, offset) &&
+                 fwrite(rgb.data(), sizeof(float), rgb.size(), file) == rgb.size();
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count && ok; ++i)
+        {
+            const float* row = rows + i * row_stride;
+            if (format == ImageFormat::HDR)
+                ok = write_hdr_row(row);
+            else
+                ok = fwrite(row, sizeof(float), (size_t)width * 4, file) == (size_t)width * 4;
+        }
+    }
+
+    next_row += count;
+    return ok;
+}
+
+bool ImageWriter::close()
+{
+    if (!file)
+        return false;
+
+    const bool complete = ok && next_row == height;
+    const bool closed = fclose(file) == 0;
+    file = nullptr;
+    ok = false;
+    return complete && closed;
+}
+
+} // namespace io
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "image_io.hpp"
+
+namespace io
+{
+
+/*
+ * Streaming Image Writer (.hdr, .pfm or .rgbaf, Picked by the Extension).
+ * Rows are encoded & written as they are handed over, top to bottom, so a producer working in
+ * bands (or a readback) never has to hold the whole encoded file. Radiance scanlines are run-length
+ * encoded like the files written by Radiance itself. PFM stores its rows bottom to top, so each
+ * band is written at its final offset instead.
+ */
+class ImageWriter
+{
+  public:
+    ImageWriter() = default;
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    /* Creates the File & Writes its Header, Returns False on Failure */
+    bool open(const std::string& path, uint32_t width, uint32_t height);
+
+    /* Appends `count` RGBA32F Rows, `row_stride` Floats Apart (PFM Drops the Alpha Channel) */
+    bool write_rows(const float* rows, size_t row_stride, uint32_t count);
+
+    /* Closes the File, Returns False if a Write Failed or Rows are Missing */
+    bool close();
+
+    uint32_t get_rows_written() const { return next_row; }
+
+  private:
+    bool write_hdr_row(const float* row);
+
+  private:
+    FILE* file = nullptr;
+    ImageFormat format = ImageFormat::UNKNOWN;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t next_row = 0;
+    int64_t data_offset = 0;
+    bool ok = false;
+
+    std::vector<uint8_t> rgbe{};
+    std::vector<uint8_t> encoded{};
+    std::vector<float> rgb{};
+};
+
+} // namespace io
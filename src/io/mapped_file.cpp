@@ -0,0 +1,135 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#undef min
+#undef max
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace io
+{
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    close();
+    bytes = std::exchange(other.bytes, nullptr);
+    length = std::exchange(other.length, 0);
+#ifdef _WIN32
+    file = std::exchange(other.file, nullptr);
+    mapping = std::exchange(other.mapping, nullptr);
+#endif
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        close();
+        return false;
+    }
+
+    bytes = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!bytes)
+    {
+        close();
+        return false;
+    }
+    length = (size_t)file_size.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        UnmapViewOfFile(bytes);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+    bytes = nullptr;
+    length = 0;
+    mapping = nullptr;
+    file = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    /* The mapping keeps its own reference to the file, the descriptor is not needed afterwards */
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+        return false;
+
+    bytes = (const uint8_t*)view;
+    length = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        munmap((void*)bytes, length);
+    bytes = nullptr;
+    length = 0;
+}
+
+#endif
+
+} // namespace io
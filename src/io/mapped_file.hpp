@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace io
+{
+
+/*
+ * Read-Only Memory Mapping of a Whole File.
+ * The pages are only read in when touched, so the data can be handed to an upload (or parsed)
+ * without copying it into a buffer first. The mapping is released when the object is closed or
+ * destroyed.
+ */
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /* Maps the File, Returns False if it Does Not Exist, is Empty or Cannot be Mapped */
+    bool open(const char* path);
+    void close();
+
+    bool is_open() const { return bytes != nullptr; }
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+  private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+} // namespace io
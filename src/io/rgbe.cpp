@@ -0,0 +1,21 @@
+#include "rgbe.hpp"
+
+#include "fft/kernels.hpp"
+
+namespace io
+{
+
+RgbeToFloatFn get_rgbe_to_float()
+{
+    switch (fft::get_kernels().isa)
+    {
+    case fft::Isa::AVX512:
+        return avx512::rgbe_to_float;
+    case fft::Isa::AVX2:
+        return avx2::rgbe_to_float;
+    default:
+        return scalar::rgbe_to_float;
+    }
+}
+
+} // namespace io
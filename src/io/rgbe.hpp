@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace io
+{
+
+/* Converts `count` Interleaved RGBE Pixels (Radiance .hdr) to RGBA32F, Alpha is Set to 1 */
+using RgbeToFloatFn = void (*)(const uint8_t* src, float* dst, size_t count);
+
+/* Returns the Conversion for the Instruction Set of the Active FFT Kernels (fft::set_isa) */
+RgbeToFloatFn get_rgbe_to_float();
+
+/* Per Instruction Set Entry Points (rgbe_*.cpp) */
+namespace scalar
+{
+void rgbe_to_float(const uint8_t* src, float* dst, size_t count);
+}
+namespace avx2
+{
+void rgbe_to_float(const uint8_t* src, float* dst, size_t count);
+}
+namespace avx512
+{
+void rgbe_to_float(const uint8_t* src, float* dst, size_t count);
+}
+
+} // namespace io
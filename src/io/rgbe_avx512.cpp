@@ -0,0 +1,17 @@
+/* Compiled with AVX-512F, AVX2 & FMA enabled (see CMakeLists.txt), only called if supported */
+#include "rgbe.hpp"
+#include "rgbe_convert.hpp"
+
+namespace io::avx512
+{
+
+void rgbe_to_float(const uint8_t* src, float* dst, size_t count)
+{
+#if defined(__AVX512F__)
+    io::rgbe_to_float<fft::Avx512Vec>(src, dst, count);
+#else
+    io::rgbe_to_float<fft::ScalarVec>(src, dst, count);
+#endif
+}
+
+} // namespace io::avx512
@@ -0,0 +1,111 @@
+#pragma once
+
+/*
+ * RGBE -> Float Conversion of Radiance Pixels, Templated on a SIMD Type (Only Included by the
+ * rgbe_*.cpp Files). A pixel is (r, g, b, e) with value = mantissa * 2^(e - 136), the scale
+ * is built directly from the exponent bits (e << 23 is the float 2^(e - 127)) instead of calling
+ * ldexp. e = 255 would give infinity that way, so its missing power of two is moved into the
+ * mantissa scale. The results match stb_image bit for bit for every exponent, including e = 0
+ * (black): both products are exact, as every m * 2^(e - 136) is representable.
+ */
+
+#include <cstring>
+#include <type_traits>
+
+#include "fft/simd.hpp"
+
+namespace io
+{
+namespace
+{
+
+/* Bits of 2^-9, Which Turns the 2^(e - 127) of the Exponent Bits Into 2^(e - 136) */
+constexpr uint32_t RGBE_MANTISSA_SCALE_BITS = 118u << 23;
+
+inline void rgbe_to_float_scalar(const uint8_t* src, float* dst, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, src += 4, dst += 4)
+    {
+        /* carry is 1 for e = 255 only, whose scale would be the exponent bits of infinity */
+        const uint32_t exponent = src[3];
+        const uint32_t carry = (exponent + 1) >> 8;
+        const uint32_t bits = (exponent - carry) << 23;
+        const uint32_t mantissa_bits = RGBE_MANTISSA_SCALE_BITS + (carry << 23);
+        float scale = 0.0f, mantissa_scale = 0.0f;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        std::memcpy(&mantissa_scale, &mantissa_bits, sizeof(mantissa_scale));
+
+        dst[0] = (float)src[0] * mantissa_scale * scale;
+        dst[1] = (float)src[1] * mantissa_scale * scale;
+        dst[2] = (float)src[2] * mantissa_scale * scale;
+        dst[3] = 1.0f;
+    }
+}
+
+/* Converts `count` Interleaved RGBE Pixels to RGBA32F (Alpha 1) */
+template <typename V>
+void rgbe_to_float(const uint8_t* src, float* dst, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__AVX512F__)
+    if constexpr (std::is_same_v<V, fft::Avx512Vec>)
+    {
+        /* 4 pixels per vector, every lane takes the exponent of its pixel */
+        const __m512i exponent_lanes =
+            _mm512_setr_epi32(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+        const __m512i mantissa_bits = _mm512_set1_epi32((int32_t)RGBE_MANTISSA_SCALE_BITS);
+        const __m512i one_bit = _mm512_set1_epi32(1);
+        const __m512 one = _mm512_set1_ps(1.0f);
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m512i bytes =
+                _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(src + i * 4)));
+            const __m512i exponent = _mm512_permutexvar_epi32(exponent_lanes, bytes);
+            const __m512i carry = _mm512_srli_epi32(_mm512_add_epi32(exponent, one_bit), 8);
+            const __m512 scale =
+                _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_sub_epi32(exponent, carry), 23));
+            const __m512 mantissa_scale = _mm512_castsi512_ps(
+                _mm512_add_epi32(mantissa_bits, _mm512_slli_epi32(carry, 23)));
+            const __m512 mantissa = _mm512_mul_ps(_mm512_cvtepi32_ps(bytes), mantissa_scale);
+            const __m512 rgba = _mm512_mask_blend_ps(0x8888, _mm512_mul_ps(mantissa, scale), one);
+            _mm512_storeu_ps(dst + i * 4, rgba);
+        }
+    }
+#endif
+
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<V, fft::Avx2Vec>)
+    {
+        /* 2 pixels per vector, every lane takes the exponent of its pixel */
+        const __m256i exponent_lanes = _mm256_setr_epi32(3, 3, 3, 3, 7, 7, 7, 7);
+        const __m256i mantissa_bits = _mm256_set1_epi32((int32_t)RGBE_MANTISSA_SCALE_BITS);
+        const __m256i one_bit = _mm256_set1_epi32(1);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i pixels = _mm_loadu_si128((const __m128i*)(src + i * 4));
+            const __m256i halves[2] = {_mm256_cvtepu8_epi32(pixels),
+                                       _mm256_cvtepu8_epi32(_mm_srli_si128(pixels, 8))};
+            for (uint32_t h = 0; h < 2; ++h)
+            {
+                const __m256i exponent = _mm256_permutevar8x32_epi32(halves[h], exponent_lanes);
+                const __m256i carry = _mm256_srli_epi32(_mm256_add_epi32(exponent, one_bit), 8);
+                const __m256 scale =
+                    _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_sub_epi32(exponent, carry), 23));
+                const __m256 mantissa_scale = _mm256_castsi256_ps(
+                    _mm256_add_epi32(mantissa_bits, _mm256_slli_epi32(carry, 23)));
+                const __m256 mantissa =
+                    _mm256_mul_ps(_mm256_cvtepi32_ps(halves[h]), mantissa_scale);
+                const __m256 rgba = _mm256_blend_ps(_mm256_mul_ps(mantissa, scale), one, 0x88);
+                _mm256_storeu_ps(dst + (i + h * 2) * 4, rgba);
+            }
+        }
+    }
+#endif
+
+    rgbe_to_float_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+} // namespace
+} // namespace io
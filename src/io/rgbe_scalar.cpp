@@ -0,0 +1,12 @@
+#include "rgbe.hpp"
+#include "rgbe_convert.hpp"
+
+namespace io::scalar
+{
+
+void rgbe_to_float(const uint8_t* src, float* dst, size_t count)
+{
+    io::rgbe_to_float<fft::ScalarVec>(src, dst, count);
+}
+
+} // namespace io::scalar
@@ -0,0 +1,184 @@
+#include "image_readback.hpp"
+
+#include <graphite/vram_bank.hh>
+#include <graphite/render_graph.hh>
+#include <graphite/nodes/compute_node.hh>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <vector>
+
+#include "io/image_writer.hpp"
+#include "renderer.hpp"
+
+ImageReadback::~ImageReadback()
+{
+    /* Without end() the results in flight are lost, but the writer still has to be joined */
+    if (!writer.joinable())
+        return;
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+}
+
+void ImageReadback::init(VRAMBank& vram_bank, const std::string& output_path, uint32_t image_width,
+                         uint32_t image_height)
+{
+    bank = &vram_bank;
+    path = output_path;
+    width = image_width;
+    height = image_height;
+
+    /* Host visible, the writer reads the rows straight out of them */
+    for (Slot& slot : slots)
+        slot.buffer = bank->create_buffer("Readback Buffer",
+                                          BufferUsage::Storage | BufferUsage::Readback,
+                                          (uint64_t)width * height, 4u * sizeof(float))
+                          .expect("failed to initialize readback buffer.");
+
+    writer = std::thread(&ImageReadback::write_results, this);
+}
+
+void ImageReadback::new_graph()
+{
+    {
+        std::lock_guard lock(mutex);
+        ++graphs;
+
+        /* The graphs up to MAX_GRAPHS_IN_FLIGHT back have finished, so have their copies */
+        for (uint32_t i = 0; i < READBACK_BUFFERS; ++i)
+        {
+            Slot& slot = slots[i];
+            if (slot.state != SlotState::RECORDED || slot.graph + MAX_GRAPHS_IN_FLIGHT > graphs)
+                continue;
+            slot.state = SlotState::WRITING;
+            queue.push_back(i);
+        }
+    }
+    changed.notify_all();
+}
+
+void ImageReadback::copy(RenderGraph& render_graph, Image image)
+{
+    Slot* slot = nullptr;
+    {
+        /*
+         * At most one copy is recorded per graph, so of the two buffers one is either free or
+         * being written (the other one may still be in flight): waiting for the writer is enough.
+         */
+        std::unique_lock lock(mutex);
+        const auto find_free = [&]() -> Slot* {
+            for (Slot& candidate : slots)
+                if (candidate.state == SlotState::FREE)
+                    return &candidate;
+            return nullptr;
+        };
+        const auto writing = [&]() {
+            return std::any_of(std::begin(slots), std::end(slots),
+                               [](const Slot& s) { return s.state == SlotState::WRITING; });
+        };
+        changed.wait(lock, [&]() { return find_free() || !writing(); });
+
+        slot = find_free();
+        if (!slot)
+        {
+            printf("no free readback buffer, result %llu is dropped.\n",
+                   (unsigned long long)results);
+            return;
+        }
+        slot->state = SlotState::RECORDED;
+        slot->graph = graphs;
+        slot->result = results++;
+    }
+
+    const ReadbackData data{width, height};
+    // clang-format off
+    render_graph.add_compute_pass("Readback", "readback.cs")
+                .read(image)
+                .write(slot->buffer)
+                .push_constants(&data, 0, sizeof(ReadbackData))
+                .group_size(16, 16)
+                .work_size(width, height);
+    // clang-format on
+}
+
+void ImageReadback::end()
+{
+    if (!writer.joinable())
+        return;
+
+    {
+        std::lock_guard lock(mutex);
+        for (uint32_t i = 0; i < READBACK_BUFFERS; ++i)
+        {
+            if (slots[i].state != SlotState::RECORDED)
+                continue;
+            slots[i].state = SlotState::WRITING;
+            queue.push_back(i);
+        }
+        stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+
+    for (Slot& slot : slots)
+        bank->destroy(slot.buffer);
+}
+
+void ImageReadback::write_results()
+{
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        changed.wait(lock, [&]() { return stopping || !queue.empty(); });
+        if (queue.empty())
+            return;
+
+        const uint32_t index = queue.front();
+        queue.pop_front();
+
+        /* The slot is not touched by the render thread until it is handed back */
+        lock.unlock();
+        write_result(slots[index]);
+        lock.lock();
+
+        slots[index].state = SlotState::FREE;
+        changed.notify_all();
+    }
+}
+
+void ImageReadback::write_result(const Slot& slot)
+{
+    const std::filesystem::path target(path);
+    const std::filesystem::path numbered =
+        target.parent_path() / (target.stem().string() + "_" + std::to_string(slot.result) +
+                                target.extension().string());
+
+    io::ImageWriter output{};
+    if (!output.open(numbered.string(), width, height))
+    {
+        printf("failed to create %s.\n", numbered.string().c_str());
+        return;
+    }
+
+    /* Band by band, the encoded file is never held as a whole */
+    const size_t row_floats = (size_t)width * 4u;
+    std::vector<float> band(row_floats * READBACK_BAND_ROWS);
+    for (uint32_t y = 0; y < height; y += READBACK_BAND_ROWS)
+    {
+        const uint32_t rows = std::min(READBACK_BAND_ROWS, height - y);
+        bank->download_buffer(slot.buffer, band.data(), y * row_floats * sizeof(float),
+                              rows * row_floats * sizeof(float))
+            .expect("failed to read back the staging buffer.");
+        if (!output.write_rows(band.data(), row_floats, rows))
+            break;
+    }
+
+    if (!output.close())
+        printf("failed to write %s.\n", numbered.string().c_str());
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <graphite/resources/handle.hh>
+
+class RenderGraph;
+class VRAMBank;
+
+/* Push Constants of readback.cs: the Size of the Image Copied Out */
+struct ReadbackData
+{
+    uint32_t width;
+    uint32_t height;
+};
+
+/* Staging Buffers the Readback Alternates Between */
+constexpr uint32_t READBACK_BUFFERS = 2u;
+
+/* Rows Copied Out of a Staging Buffer & Handed to the Writer at a Time */
+constexpr uint32_t READBACK_BAND_ROWS = 64u;
+
+/*
+ * Asynchronous Readback of the Convolved Image to Files on Disk.
+ * The graph that computes a result also copies it into one of two staging buffers (readback.cs),
+ * while the next frame renders & copies into the other. Once that graph has finished (new_graph
+ * waits for it MAX_GRAPHS_IN_FLIGHT frames later) the buffer goes to a writer thread, which drains
+ * it band by band into an io::ImageWriter & hands it back. Results are numbered, "out.hdr" is
+ * written as "out_0.hdr", "out_1.hdr", ... (.hdr, .pfm or .rgbaf, picked by the extension).
+ */
+class ImageReadback
+{
+  public:
+    ImageReadback() = default;
+    ~ImageReadback();
+
+    ImageReadback(const ImageReadback&) = delete;
+    ImageReadback& operator=(const ImageReadback&) = delete;
+
+    /* Creates the Staging Buffers for width x height Results & Starts the Writer Thread */
+    void init(VRAMBank& bank, const std::string& path, uint32_t width, uint32_t height);
+
+    /*
+     * Hands the Buffers of the Graph That Finished to the Writer, Called Once per Graph Right
+     * After new_graph (Which Waits Until at Most MAX_GRAPHS_IN_FLIGHT - 1 Graphs are in Flight)
+     */
+    void new_graph();
+
+    /* Copies the Image Into a Free Staging Buffer in the Current Graph (Waits for the Writer) */
+    void copy(RenderGraph& render_graph, Image image);
+
+    /*
+     * Writes the Remaining Results, Stops the Writer & Destroys the Buffers. Called after
+     * render_graph.deinit, which waits for the graphs in flight (so every copy has finished).
+     */
+    void end();
+
+    bool is_enabled() const { return writer.joinable(); }
+
+  private:
+    /* A Staging Buffer Goes FREE -> RECORDED (by a Graph) -> WRITING (by the Writer) -> FREE */
+    enum class SlotState
+    {
+        FREE,
+        RECORDED,
+        WRITING
+    };
+
+    struct Slot
+    {
+        Buffer buffer{};
+        SlotState state = SlotState::FREE;
+        uint64_t graph = 0;  /* Graph the copy was recorded in */
+        uint64_t result = 0; /* Number of the output file */
+    };
+
+    /* Drains Slots Into Files Until Stopped & Out of Work */
+    void write_results();
+    void write_result(const Slot& slot);
+
+  private:
+    VRAMBank* bank = nullptr;
+
+    std::string path{};
+    uint32_t width = 0u;
+    uint32_t height = 0u;
+
+    Slot slots[READBACK_BUFFERS]{};
+    uint64_t graphs = 0;
+    uint64_t results = 0;
+
+    /* Slots & the Queue of Slots to Write are Shared With the Writer Thread */
+    std::mutex mutex{};
+    std::condition_variable changed{};
+    std::deque<uint32_t> queue{};
+    bool stopping = false;
+    std::thread writer{};
+};
@@ -8,15 +8,47 @@
 
 #include <glm/glm.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <utility>
+#include <vector>
 
 #include <imgui.h>
 #include <imgui_impl_sdl3.h>
 #include <imgui_impl_vulkan.h>
 
+#include "fft/kernel_cache.hpp"
+#include "fft/multires.hpp"
+#include "fft/psf_bank.hpp"
+#include "io/image_io.hpp"
 #include "window/window.hpp"
 
+/* Storage Format of the Spectra for a Plan Precision */
+static TextureFormat spectrum_format(fft::Precision precision)
+{
+    switch (precision)
+    {
+    case fft::Precision::SINGLE:
+    default:
+        return TextureFormat::RGBA32Sfloat;
+    }
+}
+
+/* Returns the Name of the Shader Variant Compiled for an FFT Size, e.g. "real_fft_512.cs" */
+static std::string shader_variant(const char* name, uint32_t size)
+{
+    return std::string(name) + "_" + std::to_string(size) + ".cs";
+}
+
+static bool has_shader_variant(uint32_t size)
+{
+    return std::find(std::begin(FFT_SHADER_SIZES), std::end(FFT_SHADER_SIZES), size) !=
+           std::end(FFT_SHADER_SIZES);
+}
+
 Renderer::Renderer(Window& window)
     : window(window), gpu(*new GPUAdapter()), render_graph(*new RenderGraph())
 {
@@ -43,7 +75,7 @@ void Renderer::init()
     /* Initialize the Render Graph */
     render_graph.set_shader_path("assets/shaders/bin");
     render_graph.set_staging_limit(10000000u /* 10mb */);
-    render_graph.set_max_graphs_in_flight(2u); /* Double buffering */
+    render_graph.set_max_graphs_in_flight(MAX_GRAPHS_IN_FLIGHT);
     if (const Result r = render_graph.init(gpu); r.is_err())
     {
         printf("failed to initialize render graph.\nreason: %s \n", r.unwrap_err().c_str());
@@ -71,41 +103,103 @@ void Renderer::init()
         return;
     }
 
-    /* Load a test png */
-    int tex_width = -1;
-    int tex_height = -1;
-    int channels = -1;
-    float* data = nullptr;
-
-    data = stbi_loadf("assets/milan512.hdr", &tex_width, &tex_height, &channels, 4);
-    if (!data)
+    /* Load a test hdr (decoded in parallel, .rgbaf files would be mapped & uploaded in place) */
+    io::ImageFile input{};
+    if (!input.open("assets/milan512.hdr"))
     {
         printf("failed to load image.\n");
         return;
     }
+    const uint32_t tex_width = input.view().width;
+    const uint32_t tex_height = input.view().height;
+
+    /* Wide PSFs are mostly low frequency, 1/2 (1/4) resolution does about 4x (16x) less work */
+    if (const char* scale = std::getenv("LUCEO_BLOOM_SCALE"))
+    {
+        bloom_scale = (uint32_t)std::strtoul(scale, nullptr, 10);
+        if (bloom_scale != 1u && bloom_scale != 2u && bloom_scale != 4u)
+        {
+            printf("LUCEO_BLOOM_SCALE has to be 1, 2 or 4, convolving at full resolution.\n");
+            bloom_scale = 1u;
+        }
+    }
+
+    /*
+     * The FFT shaders hold a whole row in one workgroup (a thread per point), which caps the
+     * transform at the largest size they are compiled for. Larger inputs are convolved at a lower
+     * resolution by the multi-resolution path instead of being cropped.
+     */
+    const uint32_t max_fft_size = FFT_SHADER_SIZES[std::size(FFT_SHADER_SIZES) - 1];
+    const uint32_t requested_scale = bloom_scale;
+    while ((std::max(tex_width, tex_height) + bloom_scale - 1u) / bloom_scale > max_fft_size)
+        bloom_scale *= 2u;
+    if (bloom_scale != requested_scale)
+        printf("input image (%ux%u) is larger than the largest fft size (%u), convolving at 1/%u "
+               "resolution.\n",
+               tex_width, tex_height, max_fft_size, bloom_scale);
+
+    input_width = tex_width;
+    input_height = tex_height;
+    level_width = (tex_width + bloom_scale - 1u) / bloom_scale;
+    level_height = (tex_height + bloom_scale - 1u) / bloom_scale;
+
+    /* Pick the Smallest Transform Size With Compiled Shaders That Covers the (Downsampled) Image */
+    const uint32_t image_size = std::max(level_width, level_height);
+    fft_size = max_fft_size;
+    for (const uint32_t size : FFT_SHADER_SIZES)
+    {
+        if (size >= image_size)
+        {
+            fft_size = size;
+            break;
+        }
+    }
+    const uint32_t spectrum_width = fft_size / 2u + 1u;
 
     /* Initialise the Input Texture */
     {
         input_tex =
             bank.create_texture("Input Texture", TextureUsage::Sampled | TextureUsage::TransferDst,
-                                TextureFormat::RGBA32Sfloat, {(u32)tex_width, (u32)tex_height, 0})
+                                TextureFormat::RGBA32Sfloat, {tex_width, tex_height, 0})
                 .expect("failed to initialize input texture.");
-        bank.upload_texture(input_tex, data, tex_width * tex_height * 4 * sizeof(float))
+        bank.upload_texture(input_tex, input.view().pixels, input.size_bytes())
             .expect("failed to upload the input texture.");
-        free(data);
+        input.close();
+        ++generations.input;
 
         /* Initialise the Input Image */
         input_img =
             bank.create_image("Input Image", input_tex).expect("failed to initialize input image.");
     }
 
+    /* Initialise the Downsampled Input & Result Textures */
+    if (bloom_scale > 1u)
+    {
+        level_tex = bank.create_texture("Level Texture",
+                                        TextureUsage::Sampled | TextureUsage::Storage |
+                                            TextureUsage::TransferDst,
+                                        TextureFormat::RGBA32Sfloat, {level_width, level_height, 0})
+                        .expect("failed to initialize level texture.");
+        level_img =
+            bank.create_image("Level Image", level_tex).expect("failed to initialize level image.");
+
+        level_result_tex = bank.create_texture("Level Result Texture",
+                                               TextureUsage::Sampled | TextureUsage::Storage |
+                                                   TextureUsage::TransferDst,
+                                               TextureFormat::RGBA32Sfloat,
+                                               {fft_size, fft_size, 0})
+                               .expect("failed to initialize level result texture.");
+        level_result_img = bank.create_image("Level Result Image", level_result_tex)
+                               .expect("failed to initialize level result image.");
+    }
+
     /* Initialise the Kernel Texture */
     {
         aperture_tex =
             bank.create_texture("APerture Texture",
                                 TextureUsage::Sampled | TextureUsage::Storage |
                                     TextureUsage::TransferDst,
-                                TextureFormat::RGBA32Sfloat, {(u32)tex_width, (u32)tex_height, 0})
+                                TextureFormat::RGBA32Sfloat, {fft_size, fft_size, 0})
                 .expect("failed to initialize aperture texture.");
         
         /* Initialise the Input Image */
@@ -113,94 +207,63 @@ void Renderer::init()
                          .expect("failed to initialize aperture image.");
     }
 
-    /* Initialise the Complex Image Texture (Complex Version of the Input Texture) */
+    /* Initialise the PSF Texture (Normalised Intensity of the Aperture Spectrum) */
+    {
+        psf_tex = bank.create_texture("PSF Texture",
+                                      TextureUsage::Sampled | TextureUsage::Storage |
+                                          TextureUsage::TransferDst,
+                                      TextureFormat::RGBA32Sfloat, {fft_size, fft_size, 0})
+                      .expect("failed to initialize psf texture.");
+
+        /* Initialise the PSF Image */
+        psf_img = bank.create_image("PSF Image", psf_tex).expect("failed to initialize psf image.");
+    }
+
+    /* Initialise the Input Spectrum Textures (Half Spectra of the Input Texture) */
     {
         /* RG Texture */
-        image.rg_tex = bank.create_texture("Input RG Texture (Complex)",
+        image.rg_tex = bank.create_texture("Input RG Texture (Spectrum)",
                                            TextureUsage::Sampled | TextureUsage::Storage |
                                                TextureUsage::TransferDst,
-                                           TextureFormat::RGBA32Sfloat, {(u32)512, (u32)512, 0})
+                                           TextureFormat::RGBA32Sfloat,
+                                           {fft_size, spectrum_width, 0})
                            .expect("failed to initialize input rg texture.");
         /* RG Image */
-        image.rg_img = bank.create_image("Input RG Image (Complex)", image.rg_tex)
+        image.rg_img = bank.create_image("Input RG Image (Spectrum)", image.rg_tex)
                            .expect("failed to initialize input rg image.");
 
         /* B Texture */
-        image.b_tex = bank.create_texture("Input B Texture (Complex)",
+        image.b_tex = bank.create_texture("Input B Texture (Spectrum)",
                                           TextureUsage::Sampled | TextureUsage::Storage |
                                               TextureUsage::TransferDst,
-                                          TextureFormat::RGBA32Sfloat, {(u32)512, (u32)512, 0})
+                                          TextureFormat::RGBA32Sfloat,
+                                          {fft_size, spectrum_width, 0})
                           .expect("failed to initialize input b texture.");
         /* B Image */
-        image.b_img = bank.create_image("Input B Image (Complex)", image.b_tex)
+        image.b_img = bank.create_image("Input B Image (Spectrum)", image.b_tex)
                           .expect("failed to initialize input b image.");
     }
 
-    /* Initialise the Complex Aperture Texture (Complex Version of the Aperture Texture) */
+    /* Initialise the Kernel Spectrum Textures (Real Half Spectra Shared by the RGB Channels) */
+    for (uint32_t i = 0; i < KERNEL_TEXTURES; ++i)
     {
-        /* RG Texture */
-        aperture.rg_tex = bank.create_texture("Aperture RG Texture (Complex)",
+        kernel_tex[i] = bank.create_texture("Kernel Texture (Spectrum)",
                                             TextureUsage::Sampled | TextureUsage::Storage |
                                                 TextureUsage::TransferDst,
-                                            TextureFormat::RGBA32Sfloat, {(u32)512, (u32)512, 0})
-                            .expect("failed to initialize aperture rg texture.");
-        /* RG Image */
-        aperture.rg_img = bank.create_image("Aperture RG Image (Complex)", aperture.rg_tex)
-                            .expect("failed to initialize aperture rg image.");
-
-        /* B Texture */
-        aperture.b_tex = bank.create_texture("Aperture B Texture (Complex)",
-                                           TextureUsage::Sampled | TextureUsage::Storage |
-                                               TextureUsage::TransferDst,
-                                           TextureFormat::RGBA32Sfloat, {(u32)512, (u32)512, 0})
-                           .expect("failed to initialize aperture b texture.");
-        /* B Image */
-        aperture.b_img = bank.create_image("Aperture B Image (Complex)", aperture.b_tex)
-                           .expect("failed to initialize aperture b image.");
+                                            TextureFormat::RGBA32Sfloat,
+                                            {fft_size / KERNEL_TEXEL_VALUES, spectrum_width, 0})
+                            .expect("failed to initialize kernel texture.");
+        kernel_img[i] = bank.create_image("Kernel Image (Spectrum)", kernel_tex[i])
+                            .expect("failed to initialize kernel image.");
     }
 
-    /* Initialise the Complex PSF Texture (Normalised Complex-Space Aperture) */
-    {
-        /* RG Texture */
-        psf.rg_tex = bank.create_texture("Kernel RG Texture (Complex)",
-                                         TextureUsage::Sampled | TextureUsage::Storage |
-                                             TextureUsage::TransferDst,
-                                         TextureFormat::RGBA32Sfloat, {(u32)512, (u32)512, 0})
-                         .expect("failed to initialize psf rg texture.");
-        /* RG Image */
-        psf.rg_img = bank.create_image("Kernel RG Image (Complex)", psf.rg_tex)
-                         .expect("failed to initialize psf rg image.");
-
-        /* B Texture */
-        psf.b_tex = bank.create_texture("Kernel B Texture (Complex)",
-                                        TextureUsage::Sampled | TextureUsage::Storage |
-                                            TextureUsage::TransferDst,
-                                        TextureFormat::RGBA32Sfloat, {(u32)512, (u32)512, 0})
-                        .expect("failed to initialize psf b texture.");
-        /* B Image */
-        psf.b_img = bank.create_image("Kernel B Image (Complex)", psf.b_tex)
-                        .expect("failed to initialize psf b image.");
-    }
-
-    /* Initialise the Temp Texture */
-    {
-        temp_tex = bank.create_texture("Temp Texture",
-                                       TextureUsage::Sampled | TextureUsage::Storage |
-                                           TextureUsage::TransferDst,
-                                       TextureFormat::RGBA32Sfloat, {(u32)512, (u32)512, 0})
-                       .expect("failed to initialize temp texture.");
-
-        /* Initialise the temp image, from the temp texture */
-        temp_img =
-            bank.create_image("Temp Image", temp_tex).expect("failed to initialise temp image");
-    }
-
-    /* Initialise the Final Texture */
+    /* Initialise the Final Texture (at Full Resolution, Upsampled if the Level is Downsampled) */
     {
+        const uint32_t final_size = fft_size * bloom_scale;
         final_tex = bank.create_texture("Final Texture",
                                         TextureUsage::Sampled | TextureUsage::Storage |
                                             TextureUsage::TransferDst,
-                                        TextureFormat::RGBA32Sfloat, {(u32)512, (u32)512, 0})
+                                        TextureFormat::RGBA32Sfloat, {final_size, final_size, 0})
                         .expect("failed to initialize final texture.");
 
         /* Initialise the final image, from the final texture */
@@ -208,14 +271,25 @@ void Renderer::init()
             bank.create_image("Final Image", final_tex).expect("failed to initialize final image.");
     }
 
+    /* Stream the Results to Disk (Headless Batch Output), Cropped Back to the Input Size */
+    if (const char* output = std::getenv("LUCEO_OUTPUT"))
+        readback.init(bank, output, input_width, input_height);
+
     /* Initialise a Linear Sampler */
     {
         linear_sampler =
             bank.create_sampler("Linear Sampler").expect("failed to initialize linear sampler.");
     }
-}
 
-static bool flag = true;
+    /* Warm up the FFT Plans */
+    get_fft_plan({fft_size, fft_size, fft::Precision::SINGLE, fft::Direction::FORWARD});
+    get_fft_plan({fft_size, fft_size, fft::Precision::SINGLE, fft::Direction::INVERSE});
+
+    /* Start With the Cached Kernel, the GPU Chain Only Runs Once the Aperture is Edited */
+    const char* cache_dir = std::getenv("LUCEO_KERNEL_CACHE");
+    kernel_cache_dir = cache_dir ? cache_dir : KERNEL_CACHE_DIR;
+    load_kernel();
+}
 
 void Renderer::update(float dt)
 {
@@ -226,79 +300,146 @@ void Renderer::update(float dt)
     bool show_metrics = true;
     ImGui::ShowMetricsWindow(&show_metrics);
 
+    /* Aperture Controls, the Kernel is Only Rebuilt When They Change */
+    {
+        fft::ApertureParams params = aperture_state.params;
+        fft::GlowParams glow = aperture_state.glow;
+        int blades = (int)params.num_blades;
+        ImGui::Begin("Aperture");
+        ImGui::SliderInt("Blades", &blades, 3, 12);
+        ImGui::SliderFloat("Radius", &params.radius, 0.01f, 0.5f);
+        ImGui::SliderAngle("Rotation", &params.rotation, 0.0f, 360.0f);
+        ImGui::SliderFloat("Glow Sigma", &glow.sigma, 0.5f, 64.0f);
+        ImGui::SliderFloat("Glow Weight", &glow.weight, 0.0f, 1.0f);
+        ImGui::End();
+        params.num_blades = (uint32_t)blades;
+        aperture_state.set(params, glow);
+    }
+
+    /* Static Input Fast Path, Unchecking it Reruns the Whole Chain Every Frame (for Profiling) */
+    {
+        ImGui::Begin("Convolution");
+        ImGui::Checkbox("Skip Unchanged Frames", &skip_unchanged);
+        if (ImGui::Checkbox("Kernel From Autocorrelation", &autocorrelation_kernel))
+            aperture_state.dirty = true;
+        ImGui::Checkbox("Blend Kernel From PSF Bank", &use_psf_bank);
+        if (use_psf_bank)
+        {
+            ImGui::Text("PSF Bank: %s (%u Blades)", psf_bank.is_open() ? "Ready" : "Missing",
+                        bank_blades);
+            if (bank_build.valid())
+                ImGui::Text("Building the PSF Bank of %u Blades", build_blades);
+        }
+        ImGui::Text("Input Generation: %llu", (unsigned long long)generations.input);
+        ImGui::Text("Kernel Generation: %llu", (unsigned long long)generations.kernel);
+        ImGui::Text("Resolution: 1/%u (%ux%u FFT)", bloom_scale, fft_size, fft_size);
+        ImGui::End();
+    }
+
     ImGui::Render();
 
+    /* While the Aperture Changes, Blend its Kernel From the Bank (Uploaded to a Free Texture) */
+    const KernelBlend blend = aperture_state.dirty && use_psf_bank ? blend_kernel()
+                                                                   : KernelBlend::UNAVAILABLE;
+
     render_graph.new_graph().unwrap();
+    readback.new_graph();
+
+    const FFTPlan& forward =
+        get_fft_plan({fft_size, fft_size, fft::Precision::SINGLE, fft::Direction::FORWARD});
+    const FFTPlan& inverse =
+        get_fft_plan({fft_size, fft_size, fft::Precision::SINGLE, fft::Direction::INVERSE});
 
     // Render Passes
     // clang-format off
     {
-        if (flag) 
+        if (blend == KernelBlend::BLENDED)
         {
-            /* Generate Kernel */
-            //render_graph.add_compute_pass("Generate Gaussian Kernel", "gen_gauss_kernel.cs")
-            //            .write(kernel_img)
-            //            .group_size(16, 16)
-            //            .work_size(512, 512);
-            render_graph.add_compute_pass("Generate Aperture Mask", "aperture_mask.cs")
-                        .write(aperture_img)
-                        .group_size(16, 16)
-                        .work_size(512, 512);
-            
-            /* Prepare Complex Data for FFT */
-            prepare_for_fft(input_img, image);
-            prepare_for_fft(aperture_img, aperture);
-
-            /* Bring Aperture Image to Freq Domain */
-            fft(aperture.rg_img, temp_img, FFTOption::FORWARD);
-            fft(aperture.b_img,  temp_img, FFTOption::FORWARD);
-
-            /* Compute PSF */
-            render_graph.add_compute_pass("Compute PSF RG", "compute_psf.cs")
-            .read(aperture.rg_img)
-            .write(psf.rg_img)
-            .group_size(16, 16)
-            .work_size(512, 512);
-
-            render_graph.add_compute_pass("Compute PSF B", "compute_psf.cs")
-            .read(aperture.b_img)
-            .write(psf.b_img)
-            .group_size(16, 16)
-            .work_size(512, 512);
-
-            /* Bring PSF Image to Freq Domain */
-            fft(psf.rg_img, temp_img, FFTOption::FORWARD);
-            fft(psf.b_img, temp_img, FFTOption::FORWARD);
+            blend_glow(forward);
+            aperture_state.dirty = false;
+            exact_kernel_pending = true;
+            settle_time = 0.0f;
+            ++generations.kernel;
+        }
+        else if (blend == KernelBlend::DEFERRED && generations.kernel > 0)
+        {
+            /* Rebuilding on every slider tick would stall, show the last kernel until it settles */
+            aperture_state.dirty = false;
+            exact_kernel_pending = true;
+            settle_time = 0.0f;
+        }
+        else if (aperture_state.dirty)
+        {
+            build_kernel(forward, inverse);
+            aperture_state.dirty = false;
+            exact_kernel_pending = false;
+            ++generations.kernel;
+        }
+        else if (exact_kernel_pending && (settle_time += dt) >= KERNEL_SETTLE_TIME)
+        {
+            /* The sliders settled, replace the blended (or last) kernel by the exact one */
+            build_kernel(forward, inverse);
+            exact_kernel_pending = false;
+            ++generations.kernel;
+        }
+
+        /* Nothing Changed Since final_img Was Computed, Just Present it Again */
+        const bool up_to_date = skip_unchanged && final_generations == generations;
+        if (!up_to_date)
+        {
+            /* Transform the Input Itself, or its Downsampled Level & Upsample the Result Below */
+            const bool downsampled = bloom_scale > 1u;
+            const Image fft_input = downsampled ? level_img : input_img;
+            const Image result = downsampled ? level_result_img : final_img;
+            if (downsampled)
+            {
+                const ResampleData data{bloom_scale, input_width, input_height};
+                render_graph.add_compute_pass("Downsample", "downsample.cs")
+                            .read(input_img)
+                            .write(level_img)
+                            .push_constants(&data, 0, sizeof(ResampleData))
+                            .group_size(16, 16)
+                            .work_size(level_width, level_height);
+            }
 
             /* Bring Input Image to Freq Domain */
-            fft(image.rg_img, temp_img, FFTOption::FORWARD);
-            fft(image.b_img, temp_img, FFTOption::FORWARD);
+            real_fft(forward, fft_input, image);
 
-            /* Multiply (in Freq Domain) */
-            render_graph.add_compute_pass("Freq Multiply RG", "freq_multiply.cs")
+            /* Multiply (in Freq Domain, Only the Stored Half of the Spectra, One Kernel for RGB) */
+            render_graph.add_compute_pass("Freq Multiply", "freq_multiply.cs")
                         .write(image.rg_img)
-                        .read(psf.rg_img)
-                        .group_size(16, 16)
-                        .work_size(512, 512);
-            render_graph.add_compute_pass("Freq Multiply B", "freq_multiply.cs")
                         .write(image.b_img)
-                        .read(psf.b_img)
+                        .read(kernel_img[kernel_index])
                         .group_size(16, 16)
-                        .work_size(512, 512);
+                        .work_size(fft_size, forward.spectrum_width);
 
             /* Bring Input Image back to Spatial/Time Domain */
-            fft(image.rg_img, temp_img, FFTOption::INVERSE);
-            fft(image.b_img, temp_img, FFTOption::INVERSE);
+            real_ifft(inverse, image);
 
             /* Combine RG and B Textures to the Final RGBA Texture */
             render_graph.add_compute_pass("Recombine RGB", "recombine_rgb.cs")
                         .read(image.rg_img)
                         .read(image.b_img)
-                        .write(final_img)
+                        .write(result)
                         .group_size(16, 16)
-                        .work_size(512, 512);
-            
-            //flag = false;
+                        .work_size(fft_size, fft_size);
+
+            /* Upsample the Level's Result to Full Resolution */
+            if (downsampled)
+            {
+                const ResampleData data{bloom_scale, level_width, level_height};
+                render_graph.add_compute_pass("Upsample", "upsample.cs")
+                            .read(level_result_img)
+                            .write(final_img)
+                            .push_constants(&data, 0, sizeof(ResampleData))
+                            .group_size(16, 16)
+                            .work_size(fft_size * bloom_scale, fft_size * bloom_scale);
+            }
+
+            /* Copied Down While the Next Frames Render, Written by the Readback's Own Thread */
+            if (readback.is_enabled())
+                readback.copy(render_graph, final_img);
+            final_generations = generations;
         }
 
         /* Output Final Image to the Screen */
@@ -323,66 +464,376 @@ void Renderer::update(float dt)
         printf("failed to dispatch render graph.\nreason: %s \n", r.unwrap_err().c_str());
 }
 
-void Renderer::fft(Image image, Image temp, FFTOption option)
+const FFTPlan& Renderer::get_fft_plan(const fft::PlanKey& key)
+{
+    if (const auto it = fft_plans.find(key); it != fft_plans.end())
+        return it->second;
+
+    if (!has_shader_variant(key.width) || !has_shader_variant(key.height))
+        printf("no fft shaders compiled for %ux%u, see FFT_SHADER_SIZES.\n", key.width, key.height);
+
+    FFTPlan plan{};
+    plan.key = key;
+    plan.spectrum_width = key.width / 2u + 1u;
+
+    /* The shaders read their twiddles from these tables instead of calling sincos per butterfly */
+    create_twiddle_table(key.width, key.precision, plan.row_twiddle_tex, plan.row_twiddle_img);
+    create_twiddle_table(key.height, key.precision, plan.column_twiddle_tex,
+                         plan.column_twiddle_img);
+
+    if (key.direction == fft::Direction::FORWARD)
+    {
+        plan.row_shader = shader_variant("real_fft", key.width);
+        plan.column_shader = shader_variant("row_fft", key.height);
+    }
+    else
+    {
+        plan.column_shader = shader_variant("horizontal_fft", key.height);
+        plan.row_shader = shader_variant("real_ifft", key.width);
+
+        /* Initialise the Temp Texture */
+        VRAMBank& bank = gpu.get_vram_bank();
+        plan.temp_tex = bank.create_texture("Temp Texture",
+                                            TextureUsage::Sampled | TextureUsage::Storage |
+                                                TextureUsage::TransferDst,
+                                            spectrum_format(key.precision),
+                                            {plan.spectrum_width, key.height, 0})
+                            .expect("failed to initialize temp texture.");
+        plan.temp_img = bank.create_image("Temp Image", plan.temp_tex)
+                            .expect("failed to initialise temp image");
+    }
+
+    return fft_plans.emplace(key, plan).first->second;
+}
+
+void Renderer::create_twiddle_table(uint32_t size, fft::Precision precision, Texture& texture,
+                                    Image& image)
 {
-    const bool inverse = option == FFTOption::INVERSE ? true : false;
-    const std::string_view pass_name = inverse ? "Inverse FFT" : "Forward FFT";
+    /* Same angles as the CPU schedules, the inverse passes flip the sign of the imaginary part */
+    const double two_pi = 6.283185307179586;
+    std::vector<float> twiddles((size_t)size * 4u, 0.0f);
+    for (uint32_t k = 0; k < size; ++k)
+    {
+        const double angle = -two_pi * (double)k / (double)size;
+        twiddles[k * 4u + 0u] = (float)std::cos(angle);
+        twiddles[k * 4u + 1u] = (float)std::sin(angle);
+    }
 
     VRAMBank& bank = gpu.get_vram_bank();
+    texture = bank.create_texture("Twiddle Texture",
+                                  TextureUsage::Sampled | TextureUsage::Storage |
+                                      TextureUsage::TransferDst,
+                                  spectrum_format(precision), {size, 1u, 0})
+                  .expect("failed to initialize twiddle texture.");
+    bank.upload_texture(texture, twiddles.data(), twiddles.size() * sizeof(float))
+        .expect("failed to upload the twiddle texture.");
+    image =
+        bank.create_image("Twiddle Image", texture).expect("failed to initialize twiddle image.");
+}
 
+void Renderer::real_fft(const FFTPlan& plan, Image input, ComplexRGB output)
+{
+    real_fft(plan, input, output.rg_img, 0u);
+    real_fft(plan, input, output.b_img, 1u);
+}
+
+void Renderer::real_fft(const FFTPlan& plan, Image input, Image output, uint32_t flag)
+{
     Data data{};
-    data.flag = (uint32_t)inverse; // 1 is for Inverse FFT and 0 for Forward FFT
+    data.flag = flag; // 0 is for the RG Channels and 1 for the B Channel
 
+    /* The first pass transforms the rows (real input, half spectrum out) and writes them out
+     * transposed, the second one transforms the columns of the half spectrum in place */
     // clang-format off
-    render_graph.add_compute_pass(pass_name, "vertical_fft.cs")
-                .read(image)
-                .write(temp)
+    render_graph.add_compute_pass("Forward Real FFT", plan.row_shader.c_str())
+                .read(input)
+                .write(output)
+                .read(plan.row_twiddle_img)
                 .push_constants(&data, 0, sizeof(Data))
                 .group_size(1, 1)
-                .work_size(1, 512);
+                .work_size(1, plan.key.height);
+    // clang-format on
 
-    render_graph.add_compute_pass(pass_name, "horizontal_fft.cs")
-                .read(temp)
-                .write(image)
+    spectrum_columns_fft(plan, output);
+}
+
+void Renderer::build_kernel(const FFTPlan& plan, const FFTPlan& inverse)
+{
+    const std::string aperture_shader = shader_variant("aperture_mask", fft_size);
+    const std::string psf_shader = shader_variant("compute_psf", fft_size);
+    const std::string otf_shader = shader_variant("aperture_otf", fft_size);
+    const std::string gauss_shader = shader_variant("gen_gauss_kernel", fft_size);
+    /* Downsampled levels need a wider aperture (& a narrower glow) for the same bloom */
+    const fft::ApertureParams params = fft::scale_aperture(aperture_state.params, bloom_scale);
+    const fft::GlowParams glow = fft::scale_glow(aperture_state.glow, bloom_scale);
+
+    // clang-format off
+    /* Gaussian Only, its Spectrum is Written Directly in One Pass */
+    if (glow.weight >= 1.0f)
+    {
+        render_graph.add_compute_pass("Generate Gaussian Spectrum", gauss_shader.c_str())
+                    .write(kernel_img[kernel_index])
+                    .push_constants(&glow, 0, sizeof(fft::GlowParams))
+                    .group_size(16, 16)
+                    .work_size(fft_size / KERNEL_TEXEL_VALUES, plan.spectrum_width);
+        return;
+    }
+
+    render_graph.add_compute_pass("Generate Aperture Mask", aperture_shader.c_str())
+                .write(aperture_img)
+                .push_constants(&params, 0, sizeof(fft::ApertureParams))
+                .group_size(16, 16)
+                .work_size(fft_size, fft_size);
+
+    if (autocorrelation_kernel)
+    {
+        /* Transform One Channel of the Aperture Into psf_img (Large Enough for a Half Spectrum) */
+        real_fft(plan, aperture_img, psf_img, 1u);
+
+        /* |FFT(aperture)|², Back to the Spatial Domain it is the Aperture's Autocorrelation */
+        render_graph.add_compute_pass("Power Spectrum", "power_spectrum.cs")
+                    .write(psf_img)
+                    .group_size(16, 16)
+                    .work_size(fft_size, plan.spectrum_width);
+        real_ifft(inverse, psf_img);
+
+        /* Which is the Kernel Spectrum (Wiener-Khinchin), Copied Into the Kernel Layout */
+        render_graph.add_compute_pass("Aperture OTF", otf_shader.c_str())
+                    .read(psf_img)
+                    .write(kernel_img[kernel_index])
+                    .push_constants(&params, 0, sizeof(fft::ApertureParams))
+                    .group_size(16, 16)
+                    .work_size(fft_size / KERNEL_TEXEL_VALUES, plan.spectrum_width);
+    }
+    else
+    {
+        /* Bring One Channel of the Aperture Image to Freq Domain (psf_img as Scratch) */
+        real_fft(plan, aperture_img, psf_img, 1u);
+
+        /* Compute PSF (Over the Mask, it is Not Needed Anymore) */
+        render_graph.add_compute_pass("Compute PSF", psf_shader.c_str())
+                    .read(psf_img)
+                    .write(aperture_img)
+                    .push_constants(&params, 0, sizeof(fft::ApertureParams))
+                    .group_size(16, 16)
+                    .work_size(fft_size, fft_size);
+
+        /* Bring One Channel of the PSF Image to Freq Domain */
+        real_fft(plan, aperture_img, psf_img, 1u);
+
+        /* The PSF is Real & Centrosymmetric, Keep the Real Part of its Spectrum */
+        render_graph.add_compute_pass("Real Kernel Spectrum", "real_spectrum.cs")
+                    .read(psf_img)
+                    .write(kernel_img[kernel_index])
+                    .group_size(16, 16)
+                    .work_size(fft_size / KERNEL_TEXEL_VALUES, plan.spectrum_width);
+    }
+    // clang-format on
+
+    blend_glow(plan);
+}
+
+void Renderer::blend_glow(const FFTPlan& plan)
+{
+    const std::string gauss_shader = shader_variant("gen_gauss_kernel", fft_size);
+    const fft::GlowParams glow = fft::scale_glow(aperture_state.glow, bloom_scale);
+    if (glow.weight <= 0.0f)
+        return;
+
+    /* Blend the Gaussian Glow Beneath the Aperture Spectrum */
+    // clang-format off
+    render_graph.add_compute_pass("Blend Gaussian Spectrum", gauss_shader.c_str())
+                .write(kernel_img[kernel_index])
+                .push_constants(&glow, 0, sizeof(fft::GlowParams))
+                .group_size(16, 16)
+                .work_size(fft_size / KERNEL_TEXEL_VALUES, plan.spectrum_width);
+    // clang-format on
+}
+
+KernelBlend Renderer::blend_kernel()
+{
+    /* A Gaussian alone is a single pass anyway */
+    if (aperture_state.glow.weight >= 1.0f)
+        return KernelBlend::UNAVAILABLE;
+
+    /* Collect a finished build, its bank is opened below once its blade count is asked for */
+    if (bank_build.valid() &&
+        bank_build.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+        !bank_build.get())
+    {
+        printf("failed to build the psf bank of %u blades.\n", build_blades);
+        failed_blades = build_blades;
+    }
+
+    const fft::ApertureParams params = fft::scale_aperture(aperture_state.params, bloom_scale);
+    if (!psf_bank.is_open() || bank_blades != params.num_blades)
+    {
+        if (params.num_blades == failed_blades)
+            return KernelBlend::UNAVAILABLE;
+
+        /* One build at a time, a blade count asked for meanwhile is picked up by a later edit */
+        if (bank_build.valid())
+            return KernelBlend::DEFERRED;
+
+        /* Opened aside, so the current bank stays open if this one still has to be built */
+        const std::string path = fft::psf_bank_path(kernel_cache_dir, params.num_blades, fft_size);
+        fft::PsfBank opened{};
+        if (!opened.open(path, PSF_BANK_GRID, params.num_blades, fft_size))
+        {
+            build_blades = params.num_blades;
+            bank_build = std::async(std::launch::async, fft::build_psf_bank, path, PSF_BANK_GRID,
+                                    build_blades, fft_size, &bank_cancel);
+            return KernelBlend::DEFERRED;
+        }
+        psf_bank = std::move(opened);
+        bank_blades = params.num_blades;
+    }
+
+    std::vector<float> spectrum{};
+    psf_bank.blend(params, spectrum);
+    upload_kernel(spectrum.data(), spectrum.size() * sizeof(float));
+    return KernelBlend::BLENDED;
+}
+
+void Renderer::upload_kernel(const float* spectrum, size_t bytes)
+{
+    /* The upload is not ordered against the graphs in flight, which still read the older kernels */
+    const uint32_t next = (kernel_index + 1u) % KERNEL_TEXTURES;
+    VRAMBank& bank = gpu.get_vram_bank();
+    bank.upload_texture(kernel_tex[next], spectrum, bytes)
+        .expect("failed to upload the kernel texture.");
+    kernel_index = next;
+}
+
+void Renderer::load_kernel()
+{
+    /* The cache only holds aperture spectra, a glow is blended in by the GPU chain */
+    if (aperture_state.glow.weight > 0.0f)
+        return;
+
+    const fft::KernelCacheKey key{fft::scale_aperture(aperture_state.params, bloom_scale),
+                                  fft_size, fft::Precision::SINGLE};
+    const std::string path = fft::kernel_cache_path(kernel_cache_dir, key);
+
+    /* The cached spectrum is already packed like kernel_img, the mapped file is uploaded as is */
+    fft::MappedKernel cached{};
+    std::vector<float> packed{};
+    const float* data = nullptr;
+    size_t bytes = 0;
+    if (cached.open(path, key))
+    {
+        data = cached.spectrum();
+        bytes = cached.spectrum_bytes();
+    }
+    else
+    {
+        fft::KernelSpectrum spectrum{};
+        fft::build_kernel(key.params, fft_size, spectrum);
+        if (!fft::save_kernel(path, key, spectrum))
+            printf("failed to store the kernel in the cache (%s).\n", path.c_str());
+
+        /* Upload from the packed copy, mapping the file just written would not save anything */
+        fft::pack_kernel(spectrum, packed);
+        data = packed.data();
+        bytes = packed.size() * sizeof(float);
+    }
+
+    upload_kernel(data, bytes);
+    aperture_state.dirty = false;
+    ++generations.kernel;
+}
+
+void Renderer::spectrum_columns_fft(const FFTPlan& plan, Image spectrum)
+{
+    Data data{};
+    data.flag = 0u; // Forward FFT
+
+    // clang-format off
+    render_graph.add_compute_pass("Forward FFT", plan.column_shader.c_str())
+                .write(spectrum)
+                .read(plan.column_twiddle_img)
                 .push_constants(&data, 0, sizeof(Data))
                 .group_size(1, 1)
-                .work_size(1, 512);
+                .work_size(1, plan.spectrum_width);
     // clang-format on
 }
 
-void Renderer::prepare_for_fft(Image input, ComplexRGB output)
+void Renderer::real_ifft(const FFTPlan& plan, ComplexRGB image)
+{
+    real_ifft(plan, image.rg_img);
+    real_ifft(plan, image.b_img);
+}
+
+void Renderer::real_ifft(const FFTPlan& plan, Image spectrum)
 {
-    render_graph.add_compute_pass("Prepare FFT Input", "prepare_fft.cs")
-        .read(input)
-        .write(output.rg_img)
-        .write(output.b_img)
-        .group_size(16, 16)
-        .work_size(512, 512);
+    Data data{};
+    data.flag = 1u; // Inverse FFT
+
+    /* The first pass transforms the columns of the half spectrum and writes them out transposed,
+     * the second one transforms the rows (half spectrum in, packed real pixels out) */
+    // clang-format off
+    render_graph.add_compute_pass("Inverse FFT", plan.column_shader.c_str())
+                .read(spectrum)
+                .write(plan.temp_img)
+                .read(plan.column_twiddle_img)
+                .push_constants(&data, 0, sizeof(Data))
+                .group_size(1, 1)
+                .work_size(1, plan.spectrum_width);
+
+    render_graph.add_compute_pass("Inverse Real FFT", plan.row_shader.c_str())
+                .read(plan.temp_img)
+                .write(spectrum)
+                .read(plan.row_twiddle_img)
+                .group_size(1, 1)
+                .work_size(1, plan.key.height);
+    // clang-format on
 }
 
 void Renderer::end()
 {
+    /* Stop a bank build between two nodes, its temporary file is removed */
+    bank_cancel = true;
+    if (bank_build.valid())
+        bank_build.wait();
+    psf_bank.close();
+
     VRAMBank& bank = gpu.get_vram_bank();
     bank.destroy(input_tex);
     bank.destroy(input_img);
+    if (bloom_scale > 1u)
+    {
+        bank.destroy(level_tex);
+        bank.destroy(level_img);
+        bank.destroy(level_result_tex);
+        bank.destroy(level_result_img);
+    }
     bank.destroy(aperture_tex);
     bank.destroy(aperture_img);
+    bank.destroy(psf_tex);
+    bank.destroy(psf_img);
 
     bank.destroy(image.rg_tex);
     bank.destroy(image.rg_img);
     bank.destroy(image.b_tex);
     bank.destroy(image.b_img);
-    bank.destroy(aperture.rg_tex);
-    bank.destroy(aperture.rg_img);
-    bank.destroy(aperture.b_tex);
-    bank.destroy(aperture.b_img);
-    bank.destroy(psf.rg_tex);
-    bank.destroy(psf.rg_img);
-    bank.destroy(psf.b_tex);
-    bank.destroy(psf.b_img);
-
-    bank.destroy(temp_tex);
-    bank.destroy(temp_img);
+    for (uint32_t i = 0; i < KERNEL_TEXTURES; ++i)
+    {
+        bank.destroy(kernel_tex[i]);
+        bank.destroy(kernel_img[i]);
+    }
+
+    for (const auto& [key, plan] : fft_plans)
+    {
+        bank.destroy(plan.row_twiddle_tex);
+        bank.destroy(plan.row_twiddle_img);
+        bank.destroy(plan.column_twiddle_tex);
+        bank.destroy(plan.column_twiddle_img);
+        if (key.direction != fft::Direction::INVERSE)
+            continue;
+        bank.destroy(plan.temp_tex);
+        bank.destroy(plan.temp_img);
+    }
+    fft_plans.clear();
 
     bank.destroy(final_tex);
     bank.destroy(final_img);
@@ -395,6 +846,7 @@ void Renderer::end()
 
     /* Cleanup the VRAM bank & GPU adapter */
     render_graph.deinit().expect("failed to destroy render graph.");
+    readback.end();
     bank.deinit().expect("failed to destroy vram bank.");
     gpu.deinit().expect("failed to destroy gpu adapter.");
 }
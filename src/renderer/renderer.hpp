@@ -1,8 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <future>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
 #include <graphite/imgui.hh>
 #include <graphite/resources/handle.hh>
 
+#include "fft/convolution.hpp"
+#include "fft/fft.hpp"
+#include "fft/psf_bank.hpp"
+#include "image_readback.hpp"
+
 class GPUAdapter;
 class RenderGraph;
 class Window;
@@ -12,12 +23,74 @@ struct Data
     uint32_t flag;
 };
 
-enum class FFTOption
+/*
+ * Transform Sizes the FFT Shaders are Compiled for (fft::SIZE in "shared/fft_common.slang"),
+ * Must Match FFT_SHADER_SIZES in "scripts/cmake/shader_compilation.cmake". A row is transformed
+ * by one workgroup of a thread per point, so powers of 2 up to the workgroup size limit only.
+ */
+constexpr uint32_t FFT_SHADER_SIZES[] = {256u, 512u, 1024u};
+
+/* Real Values Packed in Each Texel of the Kernel Spectrum (Consecutive Rows, real_spectrum.cs) */
+constexpr uint32_t KERNEL_TEXEL_VALUES = 4u;
+
+/* Graphs the Render Graph Keeps in Flight (Double Buffering) */
+constexpr uint32_t MAX_GRAPHS_IN_FLIGHT = 2u;
+
+/*
+ * Kernel Spectra Uploaded From the CPU Go Round-Robin Through This Many Textures: the ones read by
+ * the graphs in flight are never overwritten, the upload lands in the one no graph reads anymore.
+ */
+constexpr uint32_t KERNEL_TEXTURES = MAX_GRAPHS_IN_FLIGHT + 1u;
+
+/* Push Constants of downsample.cs & upsample.cs: the Scale & the Size of the Image They Read */
+struct ResampleData
 {
-    INVERSE,
-    FORWARD
+    uint32_t scale;
+    uint32_t width;
+    uint32_t height;
+};
+
+/* Default Location of the On-Disk Kernel Cache (see "fft/kernel_cache.hpp") */
+constexpr const char* KERNEL_CACHE_DIR = "cache/kernels";
+
+/* Grid of the PSF Banks (Stored Next to the Kernel Cache), Changing it Rebuilds Them */
+constexpr fft::PsfBankGrid PSF_BANK_GRID{};
+
+/* Seconds Without an Aperture Change Before a Blended Kernel is Replaced by the Exact One */
+constexpr float KERNEL_SETTLE_TIME = 0.25f;
+
+/*
+ * GPU Counterpart of fft::Plan: the Shader Variants & Scratch Texture for One (Width, Height,
+ * Precision, Direction) Key. Row passes use the variant of the width, column passes the one of the
+ * height. Real images only keep the width / 2 + 1 non-redundant columns of their spectrum.
+ */
+struct FFTPlan
+{
+    fft::PlanKey key{};
+    uint32_t spectrum_width = 0;
+
+    /* Forward: real_fft (rows), row_fft (columns) */
+    /* Inverse: horizontal_fft (columns), real_ifft (rows) */
+    std::string row_shader{};
+    std::string column_shader{};
+
+    /* Twiddle Tables e^(-2πik / N) of the Row (N = Width) & Column (N = Height) Transforms */
+    Texture row_twiddle_tex{};
+    Image row_twiddle_img{};
+    Texture column_twiddle_tex{};
+    Image column_twiddle_img{};
+
+    /* Inverse only, used for Ping-Pong by the Column Pass (spectrum_width x height) */
+    Texture temp_tex{};
+    Image temp_img{};
 };
 
+/*
+ * Half Spectra of the RGB Channels of a Real Image, Stored Transposed (Height x Spectrum Width):
+ * rg holds the R & G spectra, b holds the B spectrum in xy (zw is zero). After the inverse
+ * transform they hold the pixels instead, pairs of neighbouring pixels packed together (also
+ * transposed).
+ */
 struct ComplexRGB
 {
     Texture rg_tex{};
@@ -27,6 +100,44 @@ struct ComplexRGB
     Image b_img{};
 };
 
+/* Kernel Parameters With Dirty Tracking, the Kernel Spectrum is Only Rebuilt After a Change */
+struct ApertureState
+{
+    fft::ApertureParams params{};
+    fft::GlowParams glow{};
+    bool dirty = true;
+
+    /* Marks the State Dirty if the Parameters Differ From the Current Ones */
+    void set(const fft::ApertureParams& new_params, const fft::GlowParams& new_glow)
+    {
+        if (new_params == params && new_glow == glow)
+            return;
+        params = new_params;
+        glow = new_glow;
+        dirty = true;
+    }
+};
+
+/* What blend_kernel Did With an Aperture Change */
+enum class KernelBlend
+{
+    BLENDED,    /* The blended spectrum is uploaded, the exact kernel follows once settled */
+    DEFERRED,   /* A bank is being built, keep the last kernel until the aperture settles */
+    UNAVAILABLE /* Build the exact kernel now (a Gaussian alone, or the bank failed to build) */
+};
+
+/*
+ * Generation Counters of the Convolution Inputs, Bumped Whenever the Input Image or the Kernel
+ * Spectra Change. final_img is only recomputed when they differ from the ones it was built from.
+ */
+struct Generations
+{
+    uint64_t input = 0;
+    uint64_t kernel = 0;
+
+    bool operator==(const Generations& other) const = default;
+};
+
 class Renderer
 {
   public:
@@ -41,11 +152,58 @@ class Renderer
     void end();
 
   private:
-    /* Applies a Fast Fourier Transform to the Input and stores it in the Output. */
-    void fft(Image image, Image temp, FFTOption option);
+    /*
+     * Returns the Plan for the Key, Creating it on First Use. Plans are kept until the renderer
+     * ends, so switching between resolutions only costs a lookup after warm-up.
+     */
+    const FFTPlan& get_fft_plan(const fft::PlanKey& key);
+
+    /* Creates a size x 1 Texture Holding e^(-2πik / size) in xy (Computed in Double Precision) */
+    void create_twiddle_table(uint32_t size, fft::Precision precision, Texture& texture,
+                              Image& image);
+
+    /* Applies a Real-to-Complex FFT to the RGB Channels of the Input, Storing the Half Spectra */
+    void real_fft(const FFTPlan& plan, Image input, ComplexRGB output);
+
+    /* Applies a Real-to-Complex FFT to the RG (flag 0) or B (flag 1) Channels of the Input */
+    void real_fft(const FFTPlan& plan, Image input, Image output, uint32_t flag);
+
+    /*
+     * Builds the Kernel Spectrum From the Aperture & Blends the Glow Beneath it, a Gaussian Alone
+     * is Written Straight Into the Spectrum (gen_gauss_kernel.cs). The aperture's kernel is its
+     * autocorrelation (one real FFT pair of a single channel), or with autocorrelation_kernel
+     * unset the reference chain Aperture -> FFT -> PSF -> FFT (one channel each).
+     */
+    void build_kernel(const FFTPlan& plan, const FFTPlan& inverse);
+
+    /* Blends the Scaled Glow Beneath the Aperture Spectrum in kernel_img (if its Weight is Set) */
+    void blend_glow(const FFTPlan& plan);
 
-    /* Splits the Input Image Into 2 Textures (one holds RG and the other holds B) */
-    void prepare_for_fft(Image input, ComplexRGB output);
+    /*
+     * Blends the Aperture Spectrum From the PSF Bank of the Current Blade Count & Uploads it. A
+     * missing bank is built in the background (one at a time), the open bank keeps serving its
+     * own blade count meanwhile. The glow is blended in by blend_glow afterwards.
+     */
+    KernelBlend blend_kernel();
+
+    /* Uploads a Packed Kernel Spectrum Into the Next Kernel Texture & Makes it the Current One */
+    void upload_kernel(const float* spectrum, size_t bytes);
+
+    /*
+     * Uploads the Kernel Spectrum of the Current Aperture From the On-Disk Cache. On a miss it is
+     * built on the CPU (fft::build_kernel) and stored first, so the next process just maps it. The
+     * cache files hold the packed real spectrum of kernel_img, the mapping is uploaded in place.
+     */
+    void load_kernel();
+
+    /* Applies a Forward FFT to the Columns of a (Transposed) Half Spectrum in Place */
+    void spectrum_columns_fft(const FFTPlan& plan, Image spectrum);
+
+    /* Brings Half Spectra Back to the Spatial Domain (in Place, Using the Plan's Temp Image) */
+    void real_ifft(const FFTPlan& plan, ComplexRGB image);
+
+    /* Brings One Half Spectrum Back to the Spatial Domain (Packed Pixels, in Place) */
+    void real_ifft(const FFTPlan& plan, Image spectrum);
 
   private:
     Window& window;
@@ -54,30 +212,96 @@ class Renderer
 
     RenderTarget render_target{};
 
+    /*
+     * Multi-Resolution Bloom: the Input is Downsampled by bloom_scale (1, 2 or 4, Picked by the
+     * LUCEO_BLOOM_SCALE Variable) Before the Transforms & the Result Upsampled to final_img.
+     * Inputs the largest FFT_SHADER_SIZES entry cannot cover at that scale double it until it does.
+     */
+    uint32_t bloom_scale = 1u;
+
+    /* Size of the Input Image & of its Downsampled Level (the Same Without Downsampling) */
+    uint32_t input_width = 0u;
+    uint32_t input_height = 0u;
+    uint32_t level_width = 0u;
+    uint32_t level_height = 0u;
+
+    /* Size of the (Square) Transforms, the Smallest Entry of FFT_SHADER_SIZES Covering the Level */
+    uint32_t fft_size = 0u;
+
+    std::unordered_map<fft::PlanKey, FFTPlan, fft::PlanKeyHash> fft_plans{};
+
     /* The Image We Apply the Kernel to (original source, so most likely stored as RGBA16Float or other) */
     /* Loaded by User */
     Texture input_tex{};
     Image input_img{};
 
+    /* The Downsampled Input & its Convolution, Only Created for a bloom_scale Above 1 */
+    Texture level_tex{};
+    Image level_img{};
+    Texture level_result_tex{};
+    Image level_result_img{};
+
     /* The Aperture Image That we Generate Based on User Inputs */
     Texture aperture_tex{};
     Image aperture_img{};
 
-    /* The Input Image Transformed to Complex Format (FFT Ready) */
+    /* The PSF (Kernel) Image Computed From the Aperture Spectrum */
+    Texture psf_tex{};
+    Image psf_img{};
+
+    /* The Half Spectra of the Input Image */
     ComplexRGB image;
-    /* The Aperture Image Transformed to Complex Format (FFT Ready) */
-    ComplexRGB aperture;
-    /* The PSF (kernel) Image Transformed to Complex Format (FFT Ready) */
-    ComplexRGB psf;
 
-    /* Used for Ping-Pong When Performing FFT */
-    Texture temp_tex{};
-    Image temp_img{};
+    /*
+     * The Half Spectrum of the Kernel, Only Rebuilt When the Aperture Changes. The aperture mask &
+     * the glow are the same in every channel, so one spectrum is applied to R, G & B. The PSF is
+     * real & centrosymmetric, so its spectrum is real: only the real parts are kept, packed
+     * KERNEL_TEXEL_VALUES to a texel (fft_size / 4 x spectrum_width texels). The current one is
+     * kernel_img[kernel_index], uploads move on to the next (see KERNEL_TEXTURES).
+     */
+    Texture kernel_tex[KERNEL_TEXTURES]{};
+    Image kernel_img[KERNEL_TEXTURES]{};
+    uint32_t kernel_index = 0u;
+
+    ApertureState aperture_state{};
+
+    Generations generations{};
+    /* Generations final_img Holds the Result of (Empty Until the First Convolution) */
+    std::optional<Generations> final_generations{};
+    /* Only Present final_img While Nothing Changed (Otherwise the Chain Runs Every Frame) */
+    bool skip_unchanged = true;
+
+    /* Build the Aperture Kernel as its Autocorrelation (Half the Transforms of the PSF Chain) */
+    bool autocorrelation_kernel = true;
+
+    /*
+     * Interactive Edits Blend the Kernel From a PSF Bank (see "fft/psf_bank.hpp"), the Exact
+     * Kernel is Built Once the Aperture Has Not Changed for KERNEL_SETTLE_TIME Seconds.
+     */
+    bool use_psf_bank = false;
+    fft::PsfBank psf_bank{};
+    /* Blade Count of psf_bank */
+    uint32_t bank_blades = 0u;
+    /* A Missing Bank is Built on Another Thread, Edits of Other Blade Counts Wait for the Settle */
+    std::future<bool> bank_build{};
+    uint32_t build_blades = 0u;
+    /* Blade Count Whose Build Failed, its Kernels are Built Exactly (0 = None) */
+    uint32_t failed_blades = 0u;
+    std::atomic<bool> bank_cancel{false};
+    /* The Kernel Was Blended, the Exact One is Due After settle_time Reaches KERNEL_SETTLE_TIME */
+    bool exact_kernel_pending = false;
+    float settle_time = 0.0f;
+
+    /* Directory of the Kernel Cache Files (KERNEL_CACHE_DIR, or the LUCEO_KERNEL_CACHE Variable) */
+    std::string kernel_cache_dir{};
 
     /* Used in the Final Full-Screen Triangle Pass to Output to the Swapchain */
     Texture final_tex{};
     Image final_img{};
 
+    /* Every New final_img is Also Written to Disk if the LUCEO_OUTPUT Variable Names a File */
+    ImageReadback readback{};
+
     Sampler linear_sampler{};
 
     ImGUI imgui{};